@@ -61,6 +61,8 @@
 #include <sys/wait.h>
 #include <sys/ioctl.h>
 
+#include "mm-solver.h"
+
 /* --------------------------------------------------------------------------- */
 /* Config settings */
 /* you can use CPP flags to e.g. print extra debugging messages */
@@ -91,6 +93,10 @@
 // number of colours and length of the sequence
 #define COLS 3
 #define SEQL 3
+// number of guesses in a game
+#define ATTEMPTS 5
+/* most guesses played up front that option -g searches for */
+#define STATIC_GUESSES 8
 // =======================================================
 
 // generic constants
@@ -159,8 +165,14 @@ static char *color_names[] = {"red", "green", "blue"};
 
 static int *theSeq = NULL;
 
+// no colour may occur twice in the secret (option -n, the Bulls & Cows variant)
+static int noRepeat = 0;
+
 static int *seq1, *seq2, *cpy1, *cpy2;
 
+// the results printed by showMatches(), in blocks, to stdout
+static struct mmEmitter matchesOut = {STDOUT_FILENO, 0, 0, {0}};
+
 /* --------------------------------------------------------------------------- */
 
 // data structure holding data on the representation of the LCD
@@ -772,37 +784,85 @@ void showGuess(int colorNum, struct lcdDataStruct *lcd)
     }
 }
 
-/* Helper function to show user guess on LCD */
-void showMatchesLCD(int code, struct lcdDataStruct *lcd)
+/* Helper function to show the guess suggested by the solver on terminal */
+void showSuggestion(const struct mmConfig *cfg, int code)
 {
-    // Variable as index value
-    int index = 0;
+    int seq[SEQL];
+
+    mmCodeToSeq(cfg, code, seq);
+    fprintf(stderr, "Suggestion:");
+    for (int i = 0; i < seqlen; i++)
+        fprintf(stderr, " %c", "RGB"[seq[i] - 1]);
+    fprintf(stderr, "\n");
+}
 
-    // Temporary array to store encoded values
-    int *temp = (int *)malloc(2 * sizeof(int));
+/* Helper function to suggest a guess within @budget@ ms (option -a), showing how far the search got */
+void showAnytimeSuggestion(const struct mmConfig *cfg, const int *cands, int ncands,
+                           const struct mmSymmetry *sym, int budget)
+{
+    struct mmAnytimeStats st;
+    int guess = mmSelectGuessAnytime(cfg, MM_MINIMAX, cands, ncands, sym, (uint64_t)budget * 1000, NULL, &st);
 
-    char *text = (char *)malloc(3 * sizeof(char)); // rifrof
+    showSuggestion(cfg, guess);
+    if (st.total)
+        fprintf(stderr, "(scored %d of %d guesses in %llu us, %d codes left)\n",
+                st.covered, st.total, (unsigned long long)st.usec, ncands);
+    else
+        fprintf(stderr, "(scored %d guesses in %llu us, %d codes left)\n",
+                st.covered, (unsigned long long)st.usec, ncands);
+}
+
+/* Helper function to check that all colours of @guess@ are in 1..colors; a guess from the terminal may not be */
+int validGuess(const struct mmConfig *cfg, const int *guess)
+{
+    for (int i = 0; i < cfg->seqlen; i++)
+        if (guess[i] < 1 || guess[i] > cfg->colors)
+            return 0;
+    return 1;
+}
+
+/* Helper function to follow the optimal strategy from @node@, as long as the player did; -1 once they did not */
+int followTree(const struct mmConfig *cfg, const struct mmTree *tree, int node, int *guess, int code)
+{
+    // an invalid guess would map onto some other code, which may even be the tree's
+    if (node < 0 || !validGuess(cfg, guess) || mmSeqToCode(cfg, guess) != mmTreeGuess(tree, node))
+        return -1;
+    return mmTreeNext(tree, node, mmFbId(cfg, code / 10, code % 10));
+}
+
+/* Helper function to keep the codes, and symmetries, that are consistent with the answer @code@ to @guess@ */
+int updateCandidates(const struct mmConfig *cfg, int *cands, int ncands, struct mmSymmetry *sym, int *guess, int code)
+{
+    struct mmSymmetry next;
+    int g;
+
+    // an invalid guess from the terminal tells nothing
+    if (!validGuess(cfg, guess))
+        return ncands;
 
-    // While loop to split code digits into array
-    // If passed argument 'code' is not 0, and the current index is less than the length of secret sequence
-    while (code != 0 && index < seqlen)
+    g = mmSeqToCode(cfg, guess);
+    ncands = mmFilter(cfg, cands, ncands, g, mmFbId(cfg, code / 10, code % 10));
+    if (mmSymRestrict(cfg, sym, g, &next) == 0)
     {
-        temp[index] = code % 10;
-        ++index;
-        code /= 10;
+        mmSymFree(sym);
+        *sym = next;
     }
+    return ncands;
+}
 
-    // Store digits in respective int values
-    int approx = temp[0];
-    int correct = temp[1];
+/* Helper function to show user guess on LCD */
+void showMatchesLCD(int code, struct lcdDataStruct *lcd)
+{
+    char *text = (char *)malloc(3 * sizeof(char)); // rifrof
 
-    // Print out correct and approximate values to terminal
-    // printf("Exact: %d    Approximate: %d\n\n", correct, approx);
-    printf("%d exact\n", correct);
-    printf("%d approximate\n", approx);
+    // Split the encoded result, exact * 10 + approximate, into its values
+    int approx = code % 10;
+    int correct = code / 10;
 
-    // Free temp array
-    free(temp);
+    // Print out correct and approximate values to terminal, as showMatches() does
+    fflush(stdout);
+    mmEmitMatches(&matchesOut, correct, approx);
+    mmEmitFlush(&matchesOut);
 
     lcdPosition(lcd, 0, 1);
     lcdPuts(lcd, "Exact: ");
@@ -825,11 +885,12 @@ void showMatchesLCD(int code, struct lcdDataStruct *lcd)
 /* AUX fcts of the game logic */
 
 
-/* initialise the secret sequence; by default it should be a random sequence */
-void initSeq()
+/* initialise the secret sequence from the one drawn by the game engine (see mm-game.c) */
+void initSeq(const struct mmGame *game)
 {
     // Allocating memory for array
-    theSeq = (int *)malloc(seqlen * sizeof(int));
+    if (theSeq == NULL)
+        theSeq = (int *)malloc(seqlen * sizeof(int));
 
     // Exit program if array is null
     if (theSeq == NULL)
@@ -837,13 +898,10 @@ void initSeq()
         printf("Array is null i.e., memory not allocated!");
         exit(0);
     }
-    // If array is not null
-    else
-    {
-        // Loop through sequence length, and add random values between 1 to 3
-        for (int i = 0; i < seqlen; ++i)
-            theSeq[i] = rand() % 3 + 1;
-    }
+
+    // The engine uses colours 0..COLS-1, the front-ends 1..COLS
+    for (int i = 0; i < seqlen; ++i)
+        theSeq[i] = game->secret[i] + 1;
 }
 
 /* display the sequence on the terminal window, using the format from the sample run in the spec */
@@ -943,34 +1001,28 @@ int /* or int* */ countMatches(int *seq1, int *seq2)
     return ret;
 }
 
+/* submit @guess@ (colours 1..COLS, anything else for none) to the game engine; returns the answer
+   encoded as by countMatches, and keeps theSeq up to date, as with -e the secret follows the answers */
+int submitGuess(struct mmGame *game, int *guess)
+{
+    uint8_t digits[SEQL];
+    int fb;
+
+    // a colour the engine does not know is a blank peg
+    for (int i = 0; i < seqlen; i++)
+        digits[i] = guess[i] >= 1 && guess[i] <= colors ? guess[i] - 1 : colors;
+    fb = mmGameGuess(game, digits);
+    initSeq(game);
+    return concat(mmFbExact(game->cfg, fb), mmFbApprox(game->cfg, fb));
+}
+
 /* show the results from calling countMatches on seq1 and seq1 */
 void showMatches(int code, int *seq1, int *seq2, int lcd_format)
 {
-    // Variable as index value
-    int index = 0;
-
-    // Temporary array to store encoded values
-    int *temp = (int *)malloc(2 * sizeof(int));
-
-    // While loop to split code digits into array
-    // If passed argument 'code' is not 0, and the current index is less than the length of secret sequence
-    while (code != 0 && index < seqlen)
-    {
-        temp[index] = code % 10;
-        ++index;
-        code /= 10;
-    }
-
-    // Store digits in respective int values
-    int approx = temp[0];
-    int correct = temp[1];
-
-    // Print out correct and approximate values to terminal
-    printf("%d exact\n", correct);
-    printf("%d approximate\n", approx);
-
-    // Free temp array
-    free(temp);
+    // the result is encoded as exact * 10 + approximate (see concat); what stdio holds goes first
+    fflush(stdout);
+    mmEmitMatches(&matchesOut, code / 10, code % 10);
+    mmEmitFlush(&matchesOut);
 }
 
 /* parse an integer value as a list of digits, and put them into @seq@ */
@@ -1017,6 +1069,80 @@ int *readNum(int max)
     return arr;
 }
 
+/* play @ngames@ games on the game engine with no I/O or delays (option -S), or one game per
+   secret if @ngames@ is 0; the guesses follow the optimal strategy if @tree@ is given (-o),
+   the anytime search within @budget@ ms if not 0 (-a), or else are the first code still
+   possible; shows the games per second, the distribution of attempts and the failures */
+void simulate(struct mmGame *game, const struct mmTree *tree, int budget, int ngames)
+{
+    const struct mmConfig *cfg = game->cfg;
+    int *cands = (int *)malloc(cfg->ncodes * sizeof(int));
+    int *secrets = (int *)malloc(cfg->ncodes * sizeof(int));
+    int nsecrets, ncands, node, guess, fb, won[ATTEMPTS + 1] = {0}, lost = 0, k, exhaustive = ngames == 0;
+    long total = 0;
+    struct mmSymmetry sym, next;
+    uint64_t t0;
+
+    // the secrets that could have been drawn; with 0 games, each of them is played once
+    nsecrets = (game->flags & MM_GAME_NOREPEAT) ? mmUniqueCodes(cfg, secrets) : mmAllCodes(cfg, secrets);
+    if (exhaustive)
+        ngames = nsecrets;
+
+    t0 = timeInMicroseconds();
+    for (k = 0; k < ngames; k++)
+    {
+        mmGameRestart(game);
+        if (exhaustive && mmGameSetSecret(game, cfg->digits + (long)secrets[k] * cfg->seqlen) != 0)
+            failure(TRUE, "simulate: unable to play the secret sequences in turn\n");
+        memcpy(cands, secrets, nsecrets * sizeof(int));
+        ncands = nsecrets;
+        node = 0;
+        if (budget)
+            mmSymInit(cfg, &sym);
+
+        while (game->state == MM_GAME_PLAYING)
+        {
+            if (tree && node >= 0)
+                guess = mmTreeGuess(tree, node);
+            else if (budget)
+                guess = mmSelectGuessAnytime(cfg, MM_MINIMAX, cands, ncands, &sym, (uint64_t)budget * 1000, NULL, NULL);
+            else
+                guess = cands[0];
+
+            fb = mmGameGuess(game, cfg->digits + (long)guess * cfg->seqlen);
+            if (tree && node >= 0)
+                node = mmTreeNext(tree, node, fb);
+            ncands = mmFilter(cfg, cands, ncands, guess, fb);
+            if (budget && mmSymRestrict(cfg, &sym, guess, &next) == 0)
+            {
+                mmSymFree(&sym);
+                sym = next;
+            }
+        }
+        if (budget)
+            mmSymFree(&sym);
+
+        if (game->state == MM_GAME_WON)
+            won[game->attempts]++;
+        else
+            lost++;
+    }
+    t0 = timeInMicroseconds() - t0;
+
+    fprintf(stdout, "Simulation: %d games in %.3f s, %.0f games/s\n", ngames, t0 / 1000000.0,
+            t0 ? ngames * 1000000.0 / t0 : 0.0);
+    for (k = 1; k <= ATTEMPTS; k++)
+        fprintf(stdout, "%d attempt%s: %d (%.2f%%)\n", k, k == 1 ? " " : "s", won[k], 100.0 * won[k] / ngames);
+    fprintf(stdout, "Failures: %d (%.2f%%)\n", lost, 100.0 * lost / ngames);
+    for (k = 1; k <= ATTEMPTS; k++)
+        total += (long)k * won[k];
+    if (lost < ngames)
+        fprintf(stdout, "Average: %.4f attempts per game won\n", (double)total / (ngames - lost));
+
+    free(cands);
+    free(secrets);
+}
+
 /* ======================================================= */
 /* SECTION: main fct                                       */
 /* ------------------------------------------------------- */
@@ -1027,9 +1153,6 @@ int main(int argc, char *argv[])
     int bits, rows, cols;
     unsigned char func;
 
-    // For random allocation of digits to secret sequence
-    srand(time(NULL));
-
     int found = 0, attempts = 0, i, j, code, readGuess = 0, fd, buttonPressed;
     int *attSeq;
 
@@ -1043,9 +1166,31 @@ int main(int argc, char *argv[])
     char buf[32];
 
     // variables for command-line processing
-    char str_in[20], str[20] = "some text";
+    char str[20] = "some text";
     int verbose = 0, debug = 0, help = 0, opt_m = 0, opt_n = 0, opt_s = 0, unit_test = 0, res_matches = 0;
 
+    // variables for the optimal strategy (option -o); node is -1 once the player leaves it
+    int opt_o = 0, node = 0;
+    struct mmConfig cfg;
+    struct mmTree tree;
+
+    // variables for the anytime suggestion (option -a <ms>): the codes still possible
+    int opt_a = 0, ncands = 0, *cands = NULL;
+    struct mmSymmetry sym;
+
+    // the game itself; the adversarial codemaker is a variant of it (option -e)
+    int opt_e = 0;
+    // number of games played with no I/O (option -S <n>), 0 for one per secret
+    int opt_S = -1;
+    struct mmGame game;
+    // width of the search for guesses played up front (option -g <width>), 0 for all guesses
+    int opt_g = -1;
+    // file of "seq1 seq2" lines to score in one go (option -b <file>, - for stdin)
+    char *opt_b = NULL;
+    // event log the games append to (option -l <log>), or to summarise (option -R <log>)
+    char *opt_l = NULL, *opt_R = NULL;
+    struct mmLog *eventLog = NULL;
+
     char *userInput;
     userInput = (char *)malloc(seqlen * sizeof(char));
 
@@ -1055,7 +1200,7 @@ int main(int argc, char *argv[])
     // see: man 3 getopt for docu and an example of command line parsing
     { // see the CW spec for the intended meaning of these options
         int opt;
-        while ((opt = getopt(argc, argv, "hvdus:")) != -1)
+        while ((opt = getopt(argc, argv, "hvdneuoa:b:g:l:R:s:S:")) != -1)
         {
             switch (opt)
             {
@@ -1068,14 +1213,41 @@ int main(int argc, char *argv[])
             case 'd':
                 debug = 1;
                 break;
+            case 'n':
+                noRepeat = 1;
+                break;
+            case 'e':
+                opt_e = 1;
+                break;
             case 'u':
                 unit_test = 1;
                 break;
+            case 'o':
+                opt_o = 1;
+                break;
+            case 'a':
+                opt_a = atoi(optarg);
+                break;
             case 's':
                 opt_s = atoi(optarg);
                 break;
+            case 'S':
+                opt_S = atoi(optarg);
+                break;
+            case 'b':
+                opt_b = optarg;
+                break;
+            case 'g':
+                opt_g = atoi(optarg);
+                break;
+            case 'l':
+                opt_l = optarg;
+                break;
+            case 'R':
+                opt_R = optarg;
+                break;
             default: /* '?' */
-                fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-u <seq1> <seq2>] [-s <secret seq>]  \n", argv[0]);
+                fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-n] [-e] [-o] [-a <ms>] [-S <n>] [-g <width>] [-b <file>] [-l <log>] [-R <log>] [-u <seq1> <seq2> ...] [-s <secret seq>]  \n", argv[0]);
                 exit(EXIT_FAILURE);
             }
         }
@@ -1085,14 +1257,33 @@ int main(int argc, char *argv[])
     {
         fprintf(stderr, "MasterMind program, running on a Raspberry Pi, with connected LED, button and LCD display\n");
         fprintf(stderr, "Use the button for input of numbers. The LCD display will show the matches with the secret sequence.\n");
+        fprintf(stderr, "With -o, the guess of an optimal strategy is suggested before each attempt.\n");
+        fprintf(stderr, "With -a <ms>, the best guess found within <ms> milliseconds is suggested instead.\n");
+        fprintf(stderr, "With -n, no colour occurs twice in the secret sequence.\n");
+        fprintf(stderr, "With -e, the secret is not fixed: each answer is the one that leaves the most sequences possible.\n");
+        fprintf(stderr, "With -S <n>, <n> games are played with no button, LED or LCD, by the strategy of -o or -a, or else the\n"
+                        "first sequence still possible; with -S 0, one game is played for each secret sequence (not with -e).\n");
+        fprintf(stderr, "With -g <width>, a smallest set of guesses that, all played up front, tell every secret sequence\n"
+                        "apart is shown, trying the <width> best guesses at each step (0: all of them).\n");
+        fprintf(stderr, "With -b <file>, each line \"<seq1> <seq2>\" of <file> (- for standard input) is answered with its\n"
+                        "exact and approximate matches, \"<exact> <approx>\", as with -u; a line that is not two sequences with \"ERR\".\n"
+                        "A binary corpus of pairs (see mm-corpus.c) is answered with the corpus of its scored pairs instead.\n");
+        fprintf(stderr, "With -l <log>, each guess of the games, as played or with -S, is recorded in the binary log <log>,\n"
+                        "with its answer and the time taken; with -R <log>, the games of the log are summarised.\n");
         fprintf(stderr, "For full specification of the program see: https://www.macs.hw.ac.uk/~hwloidl/Courses/F28HS/F28HS_CW2_2022.pdf\n");
-        fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-u <seq1> <seq2>] [-s <secret seq>]  \n", argv[0]);
+        fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-n] [-e] [-o] [-a <ms>] [-S <n>] [-g <width>] [-b <file>] [-l <log>] [-R <log>] [-u <seq1> <seq2> ...] [-s <secret seq>]  \n", argv[0]);
         exit(EXIT_SUCCESS);
     }
 
-    if (unit_test && optind >= argc - 1)
+    if (unit_test && (optind >= argc - 1 || (argc - optind) % 2 != 0))
     {
-        fprintf(stderr, "Expected 2 arguments after option -u\n");
+        fprintf(stderr, "Expected 2 arguments after option -u, or pairs of them\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (opt_S == 0 && opt_e)
+    {
+        fprintf(stderr, "With -e the secret follows the answers, so -S 0 cannot play each secret sequence in turn\n");
         exit(EXIT_FAILURE);
     }
 
@@ -1112,9 +1303,14 @@ int main(int argc, char *argv[])
             fprintf(stdout, "Secret sequence set to %d\n", opt_s);
     }
 
-    /* initialise the secret sequence */
-    if (!opt_s)
-        initSeq();
+    /* initialise the secret sequence; the game engine draws it */
+    if (mmConfigInit(&cfg, COLS, SEQL) != 0)
+        failure(TRUE, "setup: unable to set up the solver\n");
+    if (mmGameInit(&game, &cfg, (noRepeat ? MM_GAME_NOREPEAT : 0) | (opt_e ? MM_GAME_ADVERSARY : 0), ATTEMPTS, time(NULL)) != 0)
+        failure(TRUE, "setup: unable to set up the game\n");
+    if (opt_l && (eventLog = mmLogOpen(opt_l, &cfg, 0)) == NULL)
+        failure(TRUE, "setup: unable to open the game log %s, or it is for other sequences\n", opt_l);
+    initSeq(&game);
 
     if (debug)
         showSeq(theSeq);
@@ -1126,30 +1322,127 @@ int main(int argc, char *argv[])
 
     // check for -u option, and if so run a unit test on the matching function
     if (unit_test && argc > optind + 1)
-    { // more arguments to process; only needed with -u
-        strcpy(str_in, argv[optind]);
-        opt_m = atoi(str_in);
-        strcpy(str_in, argv[optind + 1]);
-        opt_n = atoi(str_in);
-        // CALL a test-matches function; see testm.c for an example implementation
-        readSeq(seq1, opt_m); // turn the integer number into a sequence of numbers
-        readSeq(seq2, opt_n); // turn the integer number into a sequence of numbers
-        if (verbose)
-            fprintf(stdout, "Testing match function with sequences %d and %d\n", opt_m, opt_n);
-        res_matches = countMatches(seq1, seq2);
-        showMatches(res_matches, seq1, seq2, 1);
-        exit(EXIT_SUCCESS);
+    { // more arguments to process; only needed with -u; each pair of sequences is answered in turn
+        fflush(stdout);
+        for (i = optind; i + 1 < argc; i += 2)
+        {
+            opt_m = atoi(argv[i]);
+            opt_n = atoi(argv[i + 1]);
+            // CALL a test-matches function; see testm.c for an example implementation
+            readSeq(seq1, opt_m); // turn the integer number into a sequence of numbers
+            readSeq(seq2, opt_n); // turn the integer number into a sequence of numbers
+            if (verbose)
+            {
+                mmEmitFlush(&matchesOut);
+                fprintf(stdout, "Testing match function with sequences %d and %d\n", opt_m, opt_n);
+                fflush(stdout);
+            }
+            res_matches = countMatches(seq1, seq2);
+            // the results go out in blocks, not one write per pair
+            mmEmitMatches(&matchesOut, res_matches / 10, res_matches % 10);
+        }
+        exit(mmEmitFlush(&matchesOut) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
     }
     else
     {
         /* nothing to do here; just continue with the rest of the main fct */
     }
 
+    if (opt_b)
+    { // if -b option is given, score all the lines of the file, streaming, on all the cores
+        struct mmBatchStats st;
+        struct mmCorpus corpus;
+        int fd = strcmp(opt_b, "-") == 0 ? STDIN_FILENO : open(opt_b, O_RDONLY);
+
+        if (fd < 0)
+            failure(TRUE, "setup: unable to open the file of sequences\n");
+        if (mmCorpusMap(&corpus, fd) == 0)
+        { // a binary corpus of pairs is scored as it is mapped, into a corpus of scored pairs
+            struct mmPool *pool = mmPoolCreate(0);
+            struct mmCorpusScored *scored = (struct mmCorpusScored *)malloc(corpus.count * sizeof(struct mmCorpusScored));
+
+            // the pairs are only mapped, but the scored pairs are held in memory, half as large again
+            if (scored == NULL)
+                failure(TRUE, "batch: unable to hold the %ld scored pairs of the corpus\n", corpus.count);
+            if (mmBatchScoreCorpus(&cfg, pool, &corpus, scored, &st) != 0)
+                failure(TRUE, "batch: the corpus holds no pairs of %d colours and length %d, or is too large\n", COLS, SEQL);
+            if (mmCorpusWrite(STDOUT_FILENO, &cfg, MM_CORPUS_SCORED, scored, corpus.count) != 0)
+                failure(TRUE, "batch: unable to write the scored pairs\n");
+            mmPoolDestroy(pool);
+            mmCorpusUnmap(&corpus);
+        }
+        else if (mmBatchScore(&cfg, fd, STDOUT_FILENO, 0, &st) != 0)
+            failure(TRUE, "batch: unable to read the sequences, or to write the matches\n");
+        if (verbose)
+            fprintf(stderr, "Scored %ld lines (%ld not sequences) in %.3f s\n", st.lines, st.errors, st.usec / 1000000.0);
+        exit(EXIT_SUCCESS);
+    }
+
+    if (opt_R)
+    { // if -R option is given, summarise the games of the log, as it is mapped
+        struct mmLogView view;
+        struct mmLogStats st;
+        uint64_t t0;
+        int fd = open(opt_R, O_RDONLY);
+
+        if (fd < 0 || mmLogMap(&view, fd) != 0)
+            failure(TRUE, "log: %s is no game log\n", opt_R);
+        close(fd);
+        t0 = timeInMicroseconds();
+        mmLogScan(&view, &st);
+        t0 = timeInMicroseconds() - t0;
+        fprintf(stdout, "Log of %d colours and length %d: %ld records of %ld (%ld dropped, %ld unfinished)\n",
+                view.colors, view.seqlen, st.records, view.capacity, view.dropped, st.unfinished);
+        fprintf(stdout, "Games: %ld, won %ld, lost %ld, over %.3f s\n", st.games, st.won, st.lost,
+                (st.lastUsec - st.firstUsec) / 1000000.0);
+        for (i = 1; i <= MM_LOG_ATTEMPTS; i++)
+            if (st.attempts[i])
+                fprintf(stdout, "%d attempt%s%s: %ld (%.2f%%)\n", i, i == 1 ? " " : "s", i == MM_LOG_ATTEMPTS ? " or more" : "",
+                        st.attempts[i], 100.0 * st.attempts[i] / st.won);
+        if (st.records)
+            fprintf(stdout, "Per guess: %.1f us to guess, %.3f us to answer (at most %u us)\n",
+                    (double)st.thinkUsec / st.records, (double)st.answerUsec / st.records, st.maxAnswerUsec);
+        if (verbose)
+            fprintf(stderr, "Scanned %ld records in %.3f s\n", view.count, t0 / 1000000.0);
+        mmLogUnmap(&view);
+        exit(EXIT_SUCCESS);
+    }
+
+    if (opt_g >= 0)
+    { // if -g option is given, search for guesses that tell all secrets apart once all are answered
+        struct mmPool *pool = mmPoolCreate(0);
+        struct mmStaticStats st;
+        int guesses[STATIC_GUESSES], seq[SEQL], k;
+
+        k = mmStaticSolve(&cfg, pool, STATIC_GUESSES, opt_g, guesses, &st);
+        mmPoolDestroy(pool);
+        if (k < 0)
+            failure(TRUE, "static: no set of up to %d guesses found, or out of memory\n", STATIC_GUESSES);
+        fprintf(stdout, "%d guesses%s tell all %d sequences apart:\n", k, st.minimal ? " (no fewer can)" : "", cfg.ncodes);
+        for (i = 0; i < k; i++)
+        {
+            mmCodeToSeq(&cfg, guesses[i], seq);
+            for (j = 0; j < seqlen; j++)
+                fprintf(stdout, "%c%c", "RGB"[seq[j] - 1], j + 1 < seqlen ? ' ' : '\n');
+        }
+        if (verbose)
+            fprintf(stderr, "Searched %ld sets of guesses, scored %ld guesses in %.3f s\n", st.nodes, st.evaluated,
+                    st.usec / 1000000.0);
+        exit(EXIT_SUCCESS);
+    }
+
     if (opt_s)
     { // if -s option is given, use the sequence as secret sequence
-        if (theSeq == NULL)
-            theSeq = (int *)malloc(seqlen * sizeof(int));
+        uint8_t secret[SEQL];
+
         readSeq(theSeq, opt_s);
+        for (i = 0; i < seqlen; i++)
+            secret[i] = theSeq[i] - 1;
+        if (opt_e)
+            failure(TRUE, "setup: -s and -e cannot be combined\n");
+        if (mmGameSetSecret(&game, secret) != 0)
+            failure(TRUE, noRepeat ? "setup: the secret sequence is not valid, or repeats a colour, which -n does not allow\n"
+                                   : "setup: the secret sequence is not valid\n");
         if (verbose)
         {
             fprintf(stderr, "Running program with secret sequence:\n");
@@ -1157,6 +1450,37 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (opt_o)
+    { // if -o option is given, compute the optimal strategy once; each move is then a tree lookup
+        struct mmPool *pool = mmPoolCreate(0);
+        struct mmTreeStats st;
+
+        if (mmTreeSolve(&cfg, pool, MM_EXPECTED, NULL, &tree, &st) != 0)
+            failure(TRUE, "setup: unable to compute the optimal strategy\n");
+        mmPoolDestroy(pool);
+        if (verbose)
+            fprintf(stderr, "Optimal strategy: %.4f guesses on average, at most %d (%.3f s)\n",
+                    (double)tree.total / cfg.ncodes, tree.depth, st.usec / 1000000.0);
+    }
+
+    if (opt_a)
+    { // if -a option is given, keep track of the codes that are still possible
+        cands = (int *)malloc(cfg.ncodes * sizeof(int));
+        ncands = noRepeat ? mmUniqueCodes(&cfg, cands) : mmAllCodes(&cfg, cands);
+        mmSymInit(&cfg, &sym);
+    }
+
+    if (opt_S >= 0)
+    { // if -S option is given, play the games on the engine alone, without setting up the LCD or GPIO
+        if (eventLog)
+            mmGameSetLog(&game, eventLog);
+        simulate(&game, opt_o ? &tree : NULL, opt_a, opt_S);
+        mmGameFree(&game);
+        if (eventLog)
+            mmLogClose(eventLog);
+        exit(EXIT_SUCCESS);
+    }
+
     // -------------------------------------------------------
     // LCD constants, hard-coded: 16x2 display, using a 4-bit connection
     bits = 4;
@@ -1301,15 +1625,25 @@ int main(int argc, char *argv[])
     // optionally one of these 2 calls:
     waitForEnter();
 
+    // the game starts now, for the log
+    if (eventLog)
+        mmGameSetLog(&game, eventLog);
+
     if (debug)
     {
         printf("\n");
         printf("========================\n");
 
-        // While loop to make sure max attempts are 5
-        while (attempts < 5)
+        // Until the game engine says the game is over
+        while (game.state == MM_GAME_PLAYING)
         {
-            attempts++;
+            // The attempt being made, as counted by the game engine
+            attempts = game.attempts + 1;
+
+            if (opt_o && node >= 0)
+                showSuggestion(&cfg, mmTreeGuess(&tree, node));
+            else if (opt_a)
+                showAnytimeSuggestion(&cfg, cands, ncands, &sym, opt_a);
 
             // Get user input and store it in a char array
             printf("\nGuess%d: ", attempts);
@@ -1334,11 +1668,17 @@ int main(int argc, char *argv[])
                 }
             }
 
-            // Run countmatches on secret sequence and user sequence 
-            int sequence = countMatches(theSeq, attSeq);
+            // Submit the user sequence to the game engine, which matches it against the secret sequence
+            int sequence = submitGuess(&game, attSeq);
+
+            // Follow the optimal strategy, as long as the player did
+            if (opt_o)
+                node = followTree(&cfg, &tree, node, attSeq, sequence);
+            if (opt_a)
+                ncands = updateCandidates(&cfg, cands, ncands, &sym, attSeq, sequence);
 
-            // If there are 3 exact and 0 approx i.e., 30 when concatenated
-            if (sequence == 30)
+            // If all colours are exact
+            if (game.state == MM_GAME_WON)
             {
                 // Turn found flag to 1
                 found = 1;
@@ -1367,7 +1707,10 @@ int main(int argc, char *argv[])
             free(userInput);
             free(attSeq);
             free(theSeq);
-            
+            mmGameFree(&game);
+            if (eventLog)
+                mmLogClose(eventLog);
+
             // Quit program
             return 0;
         }
@@ -1379,6 +1722,9 @@ int main(int argc, char *argv[])
             free(userInput);
             free(attSeq);
             free(theSeq);
+            mmGameFree(&game);
+            if (eventLog)
+                mmLogClose(eventLog);
             return 0;
         }
     }
@@ -1386,14 +1732,18 @@ int main(int argc, char *argv[])
     // -----------------------------------------------------------------------------
     // +++++ main loop
     
-    while (attempts < 5)
+    while (game.state == MM_GAME_PLAYING)
     {
-        attempts++;
+        attempts = game.attempts + 1;
 
         // Print out guess on LCD
         lcdPosition(lcd, 0, 0);
         lcdPuts(lcd, "Guess:");
         
+        if (opt_o && node >= 0)
+            showSuggestion(&cfg, mmTreeGuess(&tree, node));
+        else if (opt_a)
+            showAnytimeSuggestion(&cfg, cands, ncands, &sym, opt_a);
         fprintf(stderr, "\nGuess%d:", attempts);
         int count = 0, num = 6;
 
@@ -1438,9 +1788,13 @@ int main(int argc, char *argv[])
         printf("\n");
         // Act as separator
         blinkN(gpio, RED, 2);
-        // Count matches betweeen secret sequence and user sequence
-        int sequence = countMatches(theSeq, attSeq);
-        if (sequence == 30)
+        // Count matches betweeen secret sequence and user sequence, in the game engine
+        int sequence = submitGuess(&game, attSeq);
+        if (opt_o)
+            node = followTree(&cfg, &tree, node, attSeq, sequence);
+        if (opt_a)
+            ncands = updateCandidates(&cfg, cands, ncands, &sym, attSeq, sequence);
+        if (game.state == MM_GAME_WON)
         {
             found = 1;
             // Show matches on LCD Display
@@ -1489,5 +1843,8 @@ int main(int argc, char *argv[])
     free(userInput);
     free(attSeq);
     free(theSeq);
+    mmGameFree(&game);
+    if (eventLog)
+        mmLogClose(eventLog);
     return 0;
 }
\ No newline at end of file
@@ -61,6 +61,8 @@
 #include <sys/wait.h>
 #include <sys/ioctl.h>
 
+#include "mm-solver.h"
+
 /* --------------------------------------------------------------------------- */
 /* Config settings */
 /* you can use CPP flags to e.g. print extra debugging messages */
@@ -159,6 +161,13 @@ static char *color_names[] = {"red", "green", "blue"};
 
 static int *theSeq = NULL;
 
+// the secret sequences drawn by initSeq()
+static struct mmRng seqRng;
+static int seqRngReady = 0;
+
+// the results printed by showMatches(), in blocks, to stdout
+static struct mmEmitter matchesOut = {STDOUT_FILENO, 0, 0, {0}};
+
 static int *seq1, *seq2, *cpy1, *cpy2;
 
 /* --------------------------------------------------------------------------- */
@@ -771,34 +780,16 @@ void showGuess(int colorNum, struct lcdDataStruct *lcd)
 
 void showMatchesLCD(int code, struct lcdDataStruct *lcd)
 {
-    // Variable as index value
-    int index = 0;
-
-    // Temporary array to store encoded values
-    int *temp = (int *)malloc(2 * sizeof(int));
-
     char *text = (char *)malloc(3 * sizeof(char)); // rifrof
 
-    // While loop to split code digits into array
-    // If passed argument 'code' is not 0, and the current index is less than the length of secret sequence
-    while (code != 0 && index < seqlen)
-    {
-        temp[index] = code % 10;
-        ++index;
-        code /= 10;
-    }
-
-    // Store digits in respective int values
-    int approx = temp[0];
-    int correct = temp[1];
-
-    // Print out correct and approximate values to terminal
-    // printf("Exact: %d    Approximate: %d\n\n", correct, approx);
-    printf("%d exact\n", correct);
-    printf("%d approximate\n", approx);
+    // Split the encoded result, exact * 10 + approximate, into its values
+    int approx = code % 10;
+    int correct = code / 10;
 
-    // Free temp array
-    free(temp);
+    // Print out correct and approximate values to terminal, as showMatches() does
+    fflush(stdout);
+    mmEmitMatches(&matchesOut, correct, approx);
+    mmEmitFlush(&matchesOut);
 
     lcdPosition(lcd, 0, 1);
     lcdPuts(lcd, "Exact: ");
@@ -836,9 +827,14 @@ void initSeq()
     // If array is not null
     else
     {
-        // Loop through sequence length, and add random values between 1 to 3
+        // Loop through sequence length, and add random colours between 1 and colors, with no bias
+        if (!seqRngReady)
+        {
+            mmRngSeed(&seqRng, ((uint64_t)time(NULL) << 32) ^ getpid());
+            seqRngReady = 1;
+        }
         for (int i = 0; i < seqlen; ++i)
-            theSeq[i] = rand() % 3 + 1;
+            theSeq[i] = mmRngBelow(&seqRng, colors) + 1;
     }
 }
 
@@ -1053,31 +1049,10 @@ int /* or int* */ countMatches(int *seq1, int *seq2)
 /* show the results from calling countMatches on seq1 and seq1 */
 void showMatches(int code, int *seq1, int *seq2, int lcd_format)
 {
-    // Variable as index value
-    int index = 0;
-
-    // Temporary array to store encoded values
-    int *temp = (int *)malloc(2 * sizeof(int));
-
-    // While loop to split code digits into array
-    // If passed argument 'code' is not 0, and the current index is less than the length of secret sequence
-    while (code != 0 && index < seqlen)
-    {
-        temp[index] = code % 10;
-        ++index;
-        code /= 10;
-    }
-
-    // Store digits in respective int values
-    int approx = temp[0];
-    int correct = temp[1];
-
-    // Print out correct and approximate values to terminal
-    printf("%d exact\n", correct);
-    printf("%d approximate\n", approx);
-
-    // Free temp array
-    free(temp);
+    // the result is encoded as exact * 10 + approximate (see concat); what stdio holds goes first
+    fflush(stdout);
+    mmEmitMatches(&matchesOut, code / 10, code % 10);
+    mmEmitFlush(&matchesOut);
 }
 
 /* parse an integer value as a list of digits, and put them into @seq@ */
@@ -0,0 +1,111 @@
+/*
+ * Adversarial codemaker: the secret is not fixed, but chosen answer by
+ * answer among the codes still consistent with all the answers given.
+ *
+ * To each guess, the codemaker gives the answer that keeps the most codes
+ * possible. The remaining codes are split by the guess in one stable
+ * counting pass (mmPartition), and the largest class is kept. When classes
+ * of the same size tie, the one whose best next guess, by partition entropy,
+ * tells the least is kept; the guesses for this are scored with a deadline
+ * (mmSelectGuessAnytime), so an answer always comes within the turn budget.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "mm-solver.h"
+
+int mmAdversaryInit(struct mmAdversary *adv, const struct mmConfig *cfg, const int *set, int n, uint64_t budget)
+{
+    memset(adv, 0, sizeof(*adv));
+    if (cfg->ncodes == 0 || (set && n < 1))
+        return -1;
+    adv->cfg = cfg;
+    adv->budget = budget;
+    adv->set = (int *)malloc(cfg->ncodes * sizeof(int));
+    adv->buf = (int *)malloc(cfg->ncodes * sizeof(int));
+    adv->fbs = (uint8_t *)malloc(cfg->ncodes);
+    if (!adv->set || !adv->buf || !adv->fbs)
+    {
+        mmAdversaryFree(adv);
+        return -1;
+    }
+    if (set)
+        memcpy(adv->set, set, n * sizeof(int));
+    else
+        n = mmAllCodes(cfg, adv->set);
+    adv->n = n;
+    return 0;
+}
+
+void mmAdversaryFree(struct mmAdversary *adv)
+{
+    free(adv->set);
+    free(adv->buf);
+    free(adv->fbs);
+    memset(adv, 0, sizeof(*adv));
+}
+
+int mmAdversaryAnswer(struct mmAdversary *adv, int guess)
+{
+    const struct mmConfig *cfg = adv->cfg;
+    uint64_t start = timeInMicroseconds();
+    int offs[MM_MAX_FB + 1], tied[MM_MAX_FB], ntied = 0, best, f, t, *tmp;
+    double low = 0.0;
+
+    mmPartition(cfg, guess, adv->set, adv->n, adv->buf, offs, adv->fbs);
+
+    // the largest classes; a win only when nothing else is left
+    for (f = 0; f < cfg->nfb; f++)
+    {
+        int size = offs[f + 1] - offs[f];
+        if (size == 0 || (f == cfg->winFb && size < adv->n))
+            continue;
+        if (ntied > 0 && size < offs[tied[0] + 1] - offs[tied[0]])
+            continue;
+        if (ntied > 0 && size > offs[tied[0] + 1] - offs[tied[0]])
+            ntied = 0;
+        tied[ntied++] = f;
+    }
+
+    // there is nothing to answer from
+    if (ntied == 0)
+        return -1;
+
+    // of tied classes, the one that the best next guess splits the least
+    best = tied[0];
+    for (t = 0; t < ntied && ntied > 1; t++)
+    {
+        struct mmGuessScore sc;
+        uint64_t now = timeInMicroseconds(), slice;
+
+        if (adv->budget && now - start >= adv->budget)
+            break;
+        slice = adv->budget ? (adv->budget - (now - start)) / (ntied - t) : 0;
+        if (slice == 0 && adv->budget)
+            slice = 1;
+        f = tied[t];
+        // a class that the deadline left unscored is taken as the easiest, above any entropy
+        sc.entropy = log2(cfg->nfb) + 1;
+        mmSelectGuessAnytime(cfg, MM_ENTROPY, adv->buf + offs[f], offs[f + 1] - offs[f], NULL, slice, &sc, NULL);
+        if (t == 0 || sc.entropy < low - 1e-12)
+        {
+            low = sc.entropy;
+            best = f;
+        }
+    }
+
+    // the kept class becomes the set; the buffers are swapped rather than copied
+    tmp = adv->set;
+    adv->set = adv->buf;
+    adv->buf = tmp;
+    if (offs[best] > 0)
+        memmove(adv->set, adv->set + offs[best], (offs[best + 1] - offs[best]) * sizeof(int));
+    adv->n = offs[best + 1] - offs[best];
+    adv->ties = ntied;
+    adv->usec = timeInMicroseconds() - start;
+    return best;
+}
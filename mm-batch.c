@@ -0,0 +1,469 @@
+/*
+ * Batch scoring of a stream of "code code" lines, as written for `-u`
+ * (colours 1..9, one digit each), into "exact approximate" lines.
+ *
+ * The input is cut into blocks of whole lines that go round a bounded ring:
+ * a reader thread fills the free blocks, the scoring threads parse and
+ * score any filled one, and the calling thread writes the scored blocks in
+ * order and frees them, so memory stays bounded whatever the input size.
+ * A code of up to 8 digits is parsed as one 64-bit word: all its digits
+ * are checked against the colours at once (SWAR), with no branch per digit.
+ *
+ * Pairs in a binary corpus (see mm-corpus.c) need no parsing at all: they
+ * are scored straight from the mapping, in chunks on the work pool.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "mm-solver.h"
+
+// bytes of input per block
+#define BATCH_BLOCK (1 << 20)
+// bytes a parser may read past the end of a block
+#define BATCH_SLACK 16
+// blocks in the ring per scoring thread
+#define BATCH_SLOTS_PER_THREAD 2
+// pairs of a corpus scored per task on the work pool
+#define BATCH_CHUNK (1 << 16)
+
+#define BATCH_ONES 0x0101010101010101ULL
+#define BATCH_HIGHS 0x8080808080808080ULL
+
+// states of a block in the ring
+#define BATCH_FREE 0
+#define BATCH_FILLED 1
+#define BATCH_SCORING 2
+#define BATCH_SCORED 3
+
+struct batchBlock
+{
+    int state;
+    char *in;
+    size_t inLen;
+    char *out;
+    size_t outLen;
+    long lines, errors;
+};
+
+struct batchRing
+{
+    const struct mmConfig *cfg;
+    int in, out;
+    struct batchBlock *blocks;
+    int nblocks;
+    long filled;   // blocks filled by the reader so far
+    int eof;       // the reader is done; @filled@ is the total
+    int ioError;
+    char *carry;   // start of a line cut by the end of a block
+    size_t carryLen;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+
+/* ======================================================= */
+/* SECTION: parsing and scoring                            */
+/* ------------------------------------------------------- */
+
+/* the code of @len@ digits at @p@ as 0-based colours, one per byte from the lowest; returns -1
+   if a digit is not a colour of @cfg@. Each byte c is checked as '1' <= c < '1' + colors with
+   two additions whose high bits give c >= '1' and c >= '1' + colors, for all bytes at once;
+   a byte of 0x80 or more, which could carry into the next one, fails on its own high bit */
+static inline int batchParse(const struct mmConfig *cfg, const char *p, int len, uint64_t *code)
+{
+    uint64_t mask = len == 8 ? ~0ULL : (1ULL << (8 * len)) - 1, x, ge, gt;
+
+    memcpy(&x, p, 8);
+    ge = x + (0x80 - '1') * BATCH_ONES;
+    gt = x + (0x80 - '1' - cfg->colors) * BATCH_ONES;
+    if ((ge & ~gt & ~x & BATCH_HIGHS & mask) != (BATCH_HIGHS & mask))
+        return -1;
+    *code = (x & mask) - ('1' * BATCH_ONES & mask);
+    return 0;
+}
+
+static int batchFeedback(const struct mmConfig *cfg, uint64_t a, uint64_t b)
+{
+    uint8_t da[8], db[8];
+
+    memcpy(da, &a, 8);
+    memcpy(db, &b, 8);
+    if (cfg->fbTable)
+        return mmFeedback(cfg, mmDigitsToCode(cfg, da), mmDigitsToCode(cfg, db));
+    return mmScoreDigits(cfg, da, db);
+}
+
+/* a line that is not exactly "code code": the same, after skipping spaces and a '\r' */
+static int batchParseLoose(const struct mmConfig *cfg, const char *p, const char *end, uint64_t *a, uint64_t *b)
+{
+    char field[2][8] = {{0}};
+    int n[2] = {0, 0}, f = 0;
+
+    for (; p < end; p++)
+    {
+        if (*p == ' ' || *p == '\t' || *p == '\r')
+        {
+            if (n[f] > 0 && ++f == 2)
+                break;
+            continue;
+        }
+        if (n[f] == cfg->seqlen)
+            return -1;
+        field[f][n[f]++] = *p;
+    }
+    // nothing but spaces may follow the second code
+    for (; p < end; p++)
+        if (*p != ' ' && *p != '\t' && *p != '\r')
+            return -1;
+    if (n[0] != cfg->seqlen || n[1] != cfg->seqlen)
+        return -1;
+    return batchParse(cfg, field[0], cfg->seqlen, a) | batchParse(cfg, field[1], cfg->seqlen, b);
+}
+
+/* score all lines of @b@ into its output */
+static void batchScore(const struct mmConfig *cfg, struct batchBlock *b)
+{
+    const int len = cfg->seqlen;
+    const char *p = b->in, *end = b->in + b->inLen, *nl;
+    char *o = b->out;
+    uint64_t x, y;
+    int fb;
+
+    b->lines = b->errors = 0;
+    while (p < end)
+    {
+        // the fast path: "code code\n" exactly
+        if (end - p >= 2 * len + 2 && p[len] == ' ' && p[2 * len + 1] == '\n' && batchParse(cfg, p, len, &x) == 0 &&
+            batchParse(cfg, p + len + 1, len, &y) == 0)
+            nl = p + 2 * len + 1;
+        else
+        {
+            nl = (const char *)memchr(p, '\n', end - p);
+            if (batchParseLoose(cfg, p, nl, &x, &y) != 0)
+            {
+                memcpy(o, "ERR\n", 4);
+                o += 4;
+                b->errors++;
+                b->lines++;
+                p = nl + 1;
+                continue;
+            }
+        }
+        fb = batchFeedback(cfg, x, y);
+        o[0] = '0' + mmFbExact(cfg, fb);
+        o[1] = ' ';
+        o[2] = '0' + mmFbApprox(cfg, fb);
+        o[3] = '\n';
+        o += 4;
+        b->lines++;
+        p = nl + 1;
+    }
+    b->outLen = o - b->out;
+}
+
+/* ======================================================= */
+/* SECTION: the pipeline                                   */
+/* ------------------------------------------------------- */
+
+/* fill @b@ with whole lines, starting with the line cut at the end of the last block;
+   returns 0 at the end of the input */
+static int batchFill(struct batchRing *r, struct batchBlock *b)
+{
+    size_t len = r->carryLen;
+    ssize_t k;
+    char *nl;
+
+    memcpy(b->in, r->carry, len);
+    while (len < BATCH_BLOCK)
+    {
+        k = read(r->in, b->in + len, BATCH_BLOCK - len);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k < 0)
+            r->ioError = 1;
+        if (k <= 0)
+            break;
+        len += k;
+    }
+    if (len == 0)
+        return 0;
+
+    if (len < BATCH_BLOCK)
+    {
+        // the end of the input ends a line
+        if (b->in[len - 1] != '\n')
+            b->in[len++] = '\n';
+        r->carryLen = 0;
+    }
+    else
+    {
+        for (nl = b->in + len - 1; nl >= b->in && *nl != '\n'; nl--)
+            ;
+        if (nl < b->in)
+        {
+            // a line longer than a block is no code
+            r->ioError = 1;
+            return 0;
+        }
+        r->carryLen = b->in + len - (nl + 1);
+        memcpy(r->carry, nl + 1, r->carryLen);
+        len = nl + 1 - b->in;
+    }
+    b->inLen = len;
+    return 1;
+}
+
+static void *batchReader(void *arg)
+{
+    struct batchRing *r = (struct batchRing *)arg;
+
+    for (long seq = 0;; seq++)
+    {
+        struct batchBlock *b = &r->blocks[seq % r->nblocks];
+        int more;
+
+        pthread_mutex_lock(&r->lock);
+        while (b->state != BATCH_FREE)
+            pthread_cond_wait(&r->changed, &r->lock);
+        pthread_mutex_unlock(&r->lock);
+
+        more = batchFill(r, b);
+
+        pthread_mutex_lock(&r->lock);
+        if (more)
+        {
+            b->state = BATCH_FILLED;
+            r->filled++;
+        }
+        else
+            r->eof = 1;
+        pthread_cond_broadcast(&r->changed);
+        pthread_mutex_unlock(&r->lock);
+        if (!more)
+            return NULL;
+    }
+}
+
+static void *batchWorker(void *arg)
+{
+    struct batchRing *r = (struct batchRing *)arg;
+    struct batchBlock *b;
+
+    pthread_mutex_lock(&r->lock);
+    for (;;)
+    {
+        b = NULL;
+        for (int i = 0; i < r->nblocks && b == NULL; i++)
+            if (r->blocks[i].state == BATCH_FILLED)
+                b = &r->blocks[i];
+        if (b == NULL)
+        {
+            if (r->eof)
+                break;
+            pthread_cond_wait(&r->changed, &r->lock);
+            continue;
+        }
+        b->state = BATCH_SCORING;
+        pthread_mutex_unlock(&r->lock);
+
+        batchScore(r->cfg, b);
+
+        pthread_mutex_lock(&r->lock);
+        b->state = BATCH_SCORED;
+        pthread_cond_broadcast(&r->changed);
+    }
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+/* free the ring, whether or not it got all its memory */
+static void batchRingFree(struct batchRing *r)
+{
+    for (int i = 0; r->blocks && i < r->nblocks; i++)
+    {
+        free(r->blocks[i].in);
+        free(r->blocks[i].out);
+    }
+    free(r->blocks);
+    free(r->carry);
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->changed);
+}
+
+int mmBatchScore(const struct mmConfig *cfg, int in, int out, int threads, struct mmBatchStats *st)
+{
+    struct batchRing r;
+    pthread_t reader, *workers;
+    uint64_t t0 = timeInMicroseconds();
+    int i, nworkers, res = 0, ok;
+
+    memset(st, 0, sizeof(*st));
+    if (cfg->colors > 9 || cfg->seqlen > 8)
+        return -1;
+    if (threads <= 0)
+        threads = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? (int)sysconf(_SC_NPROCESSORS_ONLN) : 1;
+
+    memset(&r, 0, sizeof(r));
+    r.cfg = cfg;
+    r.in = in;
+    r.out = out;
+    r.nblocks = BATCH_SLOTS_PER_THREAD * threads + 2;
+    pthread_mutex_init(&r.lock, NULL);
+    pthread_cond_init(&r.changed, NULL);
+    r.blocks = (struct batchBlock *)calloc(r.nblocks, sizeof(struct batchBlock));
+    r.carry = (char *)malloc(BATCH_BLOCK);
+    ok = r.blocks && r.carry;
+    for (i = 0; ok && i < r.nblocks; i++)
+    {
+        // room for a '\n' at the end of the input, and for a parser reading a word past it
+        r.blocks[i].in = (char *)calloc(BATCH_BLOCK + 1 + BATCH_SLACK, 1);
+        // at most one 4-byte answer per input byte
+        r.blocks[i].out = (char *)malloc(4 * (size_t)(BATCH_BLOCK + 1));
+        ok = r.blocks[i].in && r.blocks[i].out;
+    }
+    workers = ok ? (pthread_t *)malloc(threads * sizeof(pthread_t)) : NULL;
+    if (workers == NULL)
+    {
+        batchRingFree(&r);
+        return -1;
+    }
+
+    // the workers that start score the blocks; without one, or without the reader, nothing is read
+    for (nworkers = 0; nworkers < threads; nworkers++)
+        if (pthread_create(&workers[nworkers], NULL, batchWorker, &r) != 0)
+            break;
+    if (nworkers == 0 || pthread_create(&reader, NULL, batchReader, &r) != 0)
+    {
+        pthread_mutex_lock(&r.lock);
+        r.eof = 1;
+        pthread_cond_broadcast(&r.changed);
+        pthread_mutex_unlock(&r.lock);
+        for (i = 0; i < nworkers; i++)
+            pthread_join(workers[i], NULL);
+        free(workers);
+        batchRingFree(&r);
+        return -1;
+    }
+
+    // write the blocks in order, as they are scored
+    for (long seq = 0;; seq++)
+    {
+        struct batchBlock *b = &r.blocks[seq % r.nblocks];
+        size_t sent = 0;
+        ssize_t k;
+
+        pthread_mutex_lock(&r.lock);
+        while (b->state != BATCH_SCORED && !(r.eof && seq == r.filled))
+            pthread_cond_wait(&r.changed, &r.lock);
+        pthread_mutex_unlock(&r.lock);
+        if (b->state != BATCH_SCORED)
+            break;
+
+        while (sent < b->outLen && !res)
+        {
+            k = write(out, b->out + sent, b->outLen - sent);
+            if (k < 0 && errno == EINTR)
+                continue;
+            if (k <= 0)
+                res = -1;
+            else
+                sent += k;
+        }
+        st->lines += b->lines;
+        st->errors += b->errors;
+        st->bytesIn += b->inLen;
+        st->bytesOut += b->outLen;
+
+        pthread_mutex_lock(&r.lock);
+        b->state = BATCH_FREE;
+        pthread_cond_broadcast(&r.changed);
+        pthread_mutex_unlock(&r.lock);
+    }
+
+    pthread_join(reader, NULL);
+    for (i = 0; i < nworkers; i++)
+        pthread_join(workers[i], NULL);
+    if (r.ioError)
+        res = -1;
+
+    free(workers);
+    batchRingFree(&r);
+    st->usec = timeInMicroseconds() - t0;
+    return res;
+}
+
+/* ======================================================= */
+/* SECTION: binary corpora                                 */
+/* ------------------------------------------------------- */
+
+struct batchCorpus
+{
+    const struct mmConfig *cfg;
+    const struct mmCorpusPair *in;
+    struct mmCorpusScored *out;
+    long count;
+    long *errors; // one per worker
+};
+
+static void batchCorpusTask(void *ctx, int chunk, int worker)
+{
+    struct batchCorpus *bc = (struct batchCorpus *)ctx;
+    const struct mmConfig *cfg = bc->cfg;
+    long i = (long)chunk * BATCH_CHUNK, end = i + BATCH_CHUNK < bc->count ? i + BATCH_CHUNK : bc->count;
+    const uint32_t ncodes = cfg->ncodes;
+    int fb;
+
+    for (; i < end; i++)
+    {
+        const struct mmCorpusPair *p = &bc->in[i];
+        struct mmCorpusScored *o = &bc->out[i];
+
+        o->a = p->a;
+        o->b = p->b;
+        o->pad[0] = o->pad[1] = 0;
+        if (p->a >= ncodes || p->b >= ncodes)
+        {
+            o->exact = o->approx = MM_CORPUS_INVALID;
+            bc->errors[worker]++;
+            continue;
+        }
+        fb = mmFeedback(cfg, p->a, p->b);
+        o->exact = mmFbExact(cfg, fb);
+        o->approx = mmFbApprox(cfg, fb);
+    }
+}
+
+int mmBatchScoreCorpus(const struct mmConfig *cfg, struct mmPool *pool, const struct mmCorpus *in,
+                       struct mmCorpusScored *out, struct mmBatchStats *st)
+{
+    struct batchCorpus bc;
+    int nworkers = mmPoolSize(pool);
+    uint64_t t0 = timeInMicroseconds();
+
+    memset(st, 0, sizeof(*st));
+    if (in->kind != MM_CORPUS_PAIRS || in->colors != cfg->colors || in->seqlen != cfg->seqlen || cfg->ncodes == 0)
+        return -1;
+    bc.cfg = cfg;
+    bc.in = (const struct mmCorpusPair *)in->records;
+    bc.out = out;
+    bc.count = in->count;
+    bc.errors = (long *)calloc(nworkers, sizeof(long));
+    if (bc.errors == NULL)
+        return -1;
+
+    mmPoolFor(pool, (int)((in->count + BATCH_CHUNK - 1) / BATCH_CHUNK), batchCorpusTask, &bc);
+
+    for (int w = 0; w < nworkers; w++)
+        st->errors += bc.errors[w];
+    free(bc.errors);
+    st->lines = in->count;
+    st->bytesIn = in->count * sizeof(struct mmCorpusPair);
+    st->bytesOut = in->count * sizeof(struct mmCorpusScored);
+    st->usec = timeInMicroseconds() - t0;
+    return 0;
+}
@@ -0,0 +1,1403 @@
+/*
+  Benchmarks for the solver engine (see mm-solver.h).
+
+$ make bench
+$ ./mm-bench                 # all benchmarks on the default configurations
+$ ./mm-bench -b tree -t 4    # only the decision-tree search, on 4 threads
+$ ./mm-bench -c 6 -l 4       # use one configuration of 6 colours and length 4
+$ ./mm-bench -x              # also run the searches that take very long on big configurations
+$ ./mm-bench -b tree -m /tmp  # keep the memo stores of the tree search in /tmp, for the next run
+$ ./mm-bench -b stream -x -s /var/tmp  # stream the whole 8x10 space through files in /var/tmp
+$ ./mm-bench -b tournament -p ./my-strategy.so  # the built-in strategies and a plugin, on every secret
+$ ./mm-bench -b corpus -c 6 -l 4 -f pairs.mmc   # score the pairs (or play the codes) of a binary corpus
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "mm-solver.h"
+
+// default configurations: the game's own 3x3, classic 4x6 MasterMind, and 8x10,
+// which is too large to enumerate
+static const int configs[][2] = {{3, 3}, {6, 4}, {10, 8}};
+#define NCONFIGS (sizeof(configs) / sizeof(configs[0]))
+
+// the expected-guesses tree is only searched up to this many codes, unless -x is given
+#define TREE_EXPECTED_MAX 4096
+
+// the static solver tries all guesses at each step up to this many codes, unless -x is given
+#define STATIC_EXHAUSTIVE_MAX 256
+#define STATIC_MAX_GUESSES 8
+
+// time an anytime selection may take beyond its deadline, for the clock and the scheduler
+#define ANYTIME_SLACK 200
+#define ANYTIME_TRIES 3
+
+// time for the adversarial codemaker to break ties, per answer
+#define ADVERSARY_BUDGET 10000
+
+// memory cap of the out-of-core sets: small on enumerated spaces, to get many chunks
+#define STREAM_SMALL_CAP (16 << 10)
+#define STREAM_LARGE_CAP (64 << 20)
+
+// attempts a game may take to count as won in a tournament (ATTEMPTS in master-mind.c)
+#define TOURNAMENT_ATTEMPTS 5
+
+// sessions stepped at once, the steps made, and guesses per game
+#define SESSIONS (1 << 18)
+#define SESSION_STEPS (1 << 24)
+#define SESSION_ATTEMPTS MM_SESSION_HISTORY
+
+// lines scored by the batch scorer
+#define BATCH_LINES (1 << 22)
+
+// secrets of the corpus played in a tournament
+#define CORPUS_SECRETS (1 << 10)
+
+// draws of the random-number bench
+#define RNG_DRAWS (1 << 24)
+
+// turns played on the game engine with an event log, all of which fit in it
+#define LOG_TURNS (1 << 21)
+
+// turns played on the game engine, and guesses per game
+#define GAME_TURNS (1 << 21)
+#define GAME_ATTEMPTS 10
+
+// sequence length of the game's countMatches() (SEQL in masterFunc.c)
+#define GAME_SEQL 3
+
+static int verbose = 0, exhaustive = 0;
+// directory of the memo stores of the tree search, if any
+static const char *memoDir = NULL;
+// directory of the files of the out-of-core sets, NULL for /tmp
+static const char *streamDir = NULL;
+// a strategy plugin played in the tournament, besides the built-ins
+static const char *pluginPath = NULL;
+// a binary corpus used by the corpus bench, instead of random ones
+static const char *corpusPath = NULL;
+
+/* provided by the game (masterFunc.c); returns exact * 10 + approximate */
+int countMatches(int *seq1, int *seq2);
+
+/* -------------------------------------------------------------------------- */
+
+/* optimal decision tree, for both objectives; with -m, the memo store of each is kept
+   in a file, and a second run reuses it */
+static void benchTree(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    static const char *names[] = {"expected", "worst-case"};
+    struct mmTree tree;
+    struct mmTreeStats st;
+    struct mmMemoStats ms;
+    struct mmMemo *memo = NULL;
+    char path[1024];
+
+    for (int obj = MM_EXPECTED; obj <= MM_WORST; obj++)
+    {
+        if (obj == MM_EXPECTED && cfg->ncodes > TREE_EXPECTED_MAX && !exhaustive)
+        {
+            fprintf(stdout, "tree %dx%d %-10s: skipped (use -x)\n", cfg->seqlen, cfg->colors, names[obj]);
+            continue;
+        }
+        if (memoDir)
+        {
+            snprintf(path, sizeof(path), "%s/mm-memo-%dx%d-%s.bin", memoDir, cfg->seqlen, cfg->colors, names[obj]);
+            if ((memo = mmMemoOpen(path, cfg, obj)) == NULL)
+            {
+                fprintf(stderr, "Cannot open memo store %s\n", path);
+                return;
+            }
+        }
+        if (mmTreeSolve(cfg, pool, obj, memo, &tree, &st) != 0)
+            return;
+        fprintf(stdout, "tree %dx%d %-10s: total %ld (avg %.4f), depth %d, %d nodes; "
+                        "searched %ld, memo hits %ld, pruned %ld; %.3f s on %d threads\n",
+                cfg->seqlen, cfg->colors, names[obj], tree.total, (double)tree.total / cfg->ncodes,
+                tree.depth, tree.nnodes, st.nodes, st.memoHits, st.pruned,
+                st.usec / 1000000.0, mmPoolSize(pool));
+        if (memo)
+        {
+            mmMemoStats(memo, &ms);
+            fprintf(stdout, "tree %dx%d %-10s: %ld entries loaded from %s, %ld spilled\n", cfg->seqlen,
+                    cfg->colors, names[obj], ms.loaded, path, ms.spilled);
+            mmMemoClose(memo);
+        }
+        mmTreeFree(&tree);
+    }
+}
+
+/* guess selection over all codes vs one code per symmetry class, on the first two moves */
+static void benchSymmetry(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    struct mmSymmetry sym, next;
+    struct mmGuessScore full, reduced;
+    int *set = (int *)malloc(cfg->ncodes * sizeof(int));
+    int *reps = (int *)malloc(cfg->ncodes * sizeof(int));
+    int n = mmAllCodes(cfg, set), nreps, g, move;
+    uint64_t t0, t1, t2;
+
+    (void)pool;
+    if (cfg->ncodes == 0)
+        return;
+    mmSymInit(cfg, &sym);
+    for (move = 1; move <= 2; move++)
+    {
+        t0 = timeInMicroseconds();
+        mmSelectGuess(cfg, MM_MINIMAX, set, n, NULL, 0, &full);
+        t1 = timeInMicroseconds();
+        nreps = mmSymClasses(cfg, &sym, reps);
+        g = mmSelectGuess(cfg, MM_MINIMAX, set, n, reps, nreps, &reduced);
+        t2 = timeInMicroseconds();
+
+        fprintf(stdout, "sym %dx%d move %d: %d candidates, %d of %d guesses to score (%d symmetries); "
+                        "full %.3f ms, reduced %.3f ms; worst partition %d vs %d %s\n",
+                cfg->seqlen, cfg->colors, move, n, nreps, cfg->ncodes, sym.nelem,
+                (t1 - t0) / 1000.0, (t2 - t1) / 1000.0, full.worst, reduced.worst,
+                full.worst == reduced.worst ? "OK" : "WRONG");
+
+        // play the reduced choice against the answer with the most candidates left
+        {
+            int counts[MM_MAX_FB], f, big = 0;
+            mmPartitionCounts(cfg, g, set, n, counts);
+            for (f = 0; f < cfg->nfb; f++)
+                if (counts[f] > counts[big])
+                    big = f;
+            n = mmFilter(cfg, set, n, g, big);
+        }
+        mmSymRestrict(cfg, &sym, g, &next);
+        mmSymFree(&sym);
+        sym = next;
+    }
+    mmSymFree(&sym);
+    free(reps);
+    free(set);
+}
+
+/* anytime selection on the first move, with symmetry reduction, and on the second, without it,
+   for a few deadlines, which must be kept to within one guess */
+static void benchAnytime(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    // the last deadline, 0, means the full search
+    static const uint64_t budgets[] = {100, 1000, 10000, 0};
+    static const char *names[] = {"first move", "second move"};
+    struct mmGuessScore sc;
+    struct mmAnytimeStats st;
+    struct mmSymmetry sym;
+    int *set = (int *)malloc(cfg->ncodes * sizeof(int));
+    int n = mmAllCodes(cfg, set), counts[MM_MAX_FB], f, big = 0, move, ok = 1;
+    unsigned b;
+
+    (void)pool;
+    if (cfg->ncodes == 0 || mmSymInit(cfg, &sym) != 0)
+    {
+        free(set);
+        return;
+    }
+    for (move = 0; move < 2; move++)
+    {
+        if (move == 1)
+        {
+            // first guess 0..01..1, answered with the biggest class
+            mmPartitionCounts(cfg, cfg->colors - 1, set, n, counts);
+            for (f = 0; f < cfg->nfb; f++)
+                if (counts[f] > counts[big])
+                    big = f;
+            n = mmFilter(cfg, set, n, cfg->colors - 1, big);
+        }
+        for (b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++)
+        {
+            uint64_t t0, once;
+            int guess, kept = 0;
+
+            // a deadline may be missed once in a while, when the thread is not scheduled
+            for (int r = 0; r < ANYTIME_TRIES && !kept; r++)
+            {
+                guess = mmSelectGuessAnytime(cfg, MM_MINIMAX, set, n, move == 0 ? &sym : NULL, budgets[b], &sc, &st);
+                // a guess that was started may end after the deadline, by at most the time it takes
+                t0 = timeInMicroseconds();
+                mmScoreGuess(cfg, guess, set, n, &sc);
+                once = timeInMicroseconds() - t0;
+                kept = budgets[b] == 0 || st.usec <= budgets[b] + once + ANYTIME_SLACK;
+            }
+            ok = ok && kept;
+            fprintf(stdout, "anytime %dx%d %s, deadline %6llu us: scored %d of %d guesses in %llu us; worst partition %d\n",
+                    cfg->seqlen, cfg->colors, names[move], (unsigned long long)budgets[b], st.covered, st.total,
+                    (unsigned long long)st.usec, sc.worst);
+        }
+    }
+    fprintf(stdout, "anytime %dx%d: %s\n", cfg->seqlen, cfg->colors, ok ? "OK" : "WRONG");
+    mmSymFree(&sym);
+    free(set);
+}
+
+static void randomCode(const struct mmConfig *cfg, uint8_t *code, struct mmRng *rng)
+{
+    mmRngDigits(rng, cfg, 0, code);
+}
+
+/* constraint solver: consistent codes against filtering where the space can be
+   enumerated, and whole games where it cannot */
+static void benchCsp(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    struct mmCsp csp;
+    uint8_t secret[MM_MAX_SEQL], guess[MM_MAX_SEQL];
+    struct mmRng rng;
+    long nodes, total = 0;
+    int moves, fb;
+    uint64_t t0;
+
+    (void)pool;
+    mmRngSeed(&rng, 1701);
+    randomCode(cfg, secret, &rng);
+    mmCspInit(&csp, cfg);
+
+    if (cfg->ncodes > 0)
+    {
+        int *set = (int *)malloc(cfg->ncodes * sizeof(int));
+        int n = mmAllCodes(cfg, set);
+        long found;
+
+        for (moves = 1; moves <= 3; moves++)
+        {
+            randomCode(cfg, guess, &rng);
+            fb = mmScoreDigits(cfg, guess, secret);
+            mmCspAdd(&csp, guess, mmFbExact(cfg, fb), mmFbApprox(cfg, fb));
+            n = mmFilter(cfg, set, n, mmDigitsToCode(cfg, guess), fb);
+            t0 = timeInMicroseconds();
+            found = mmCspSearch(&csp, 0, NULL, NULL, &nodes);
+            fprintf(stdout, "csp %dx%d move %d: %ld consistent codes (filter: %d) %s, %ld nodes, %.3f ms\n",
+                    cfg->seqlen, cfg->colors, moves, found, n, found == n ? "OK" : "WRONG", nodes,
+                    (timeInMicroseconds() - t0) / 1000.0);
+        }
+        free(set);
+        mmCspFree(&csp);
+        return;
+    }
+
+    // play the first consistent code (in a random colour order) until the secret is found
+    t0 = timeInMicroseconds();
+    for (moves = 1;; moves++)
+    {
+        mmCspShuffle(&csp, 1701 + moves);
+        if (mmCspFirst(&csp, guess, &nodes) != 0)
+        {
+            fprintf(stdout, "csp %dx%d: no consistent code left, WRONG\n", cfg->seqlen, cfg->colors);
+            break;
+        }
+        total += nodes;
+        fb = mmScoreDigits(cfg, guess, secret);
+        if (fb == cfg->winFb)
+            break;
+        mmCspAdd(&csp, guess, mmFbExact(cfg, fb), mmFbApprox(cfg, fb));
+    }
+    fprintf(stdout, "csp %dx%d game: secret found in %d moves, %ld search nodes, %.3f ms per move\n",
+            cfg->seqlen, cfg->colors, moves, total, (timeInMicroseconds() - t0) / 1000.0 / moves);
+    mmCspFree(&csp);
+}
+
+/* genetic algorithm: whole games, with the fitness throughput of the batch scorer */
+static void benchGa(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    struct mmCsp csp;
+    struct mmGaParams prm = {150, 100, 60, 0, 42};
+    struct mmGaStats st;
+    uint8_t secret[MM_MAX_SEQL], guess[MM_MAX_SEQL];
+    struct mmRng rng;
+    long evaluated = 0;
+    int moves, fb;
+    uint64_t usec = 0;
+
+    mmRngSeed(&rng, 1701);
+    randomCode(cfg, secret, &rng);
+    mmCspInit(&csp, cfg);
+    for (moves = 1; moves <= 30; moves++)
+    {
+        prm.seed = 1701 + moves;
+        mmGaGuess(cfg, pool, &csp, &prm, guess, &st);
+        evaluated += st.evaluated;
+        usec += st.usec;
+        if (verbose)
+            fprintf(stdout, "  move %d: %ld generations, %d consistent codes, %.3f ms\n", moves,
+                    st.generations, st.eligible, st.usec / 1000.0);
+        fb = mmScoreDigits(cfg, guess, secret);
+        if (fb == cfg->winFb)
+            break;
+        mmCspAdd(&csp, guess, mmFbExact(cfg, fb), mmFbApprox(cfg, fb));
+    }
+    fprintf(stdout, "ga %dx%d game: secret %s in %d moves, %ld evaluations, %.0f evaluations/s, %.3f ms per move\n",
+            cfg->seqlen, cfg->colors, fb == cfg->winFb ? "found" : "NOT found", moves, evaluated,
+            usec ? evaluated * 1e6 / usec : 0.0, usec / 1000.0 / moves);
+    mmCspFree(&csp);
+
+    // answers that contradict each other leave no code to evolve, and no guess
+    mmCspInit(&csp, cfg);
+    mmCspAdd(&csp, secret, cfg->seqlen, 0);
+    mmCspAdd(&csp, secret, 0, 0);
+    fprintf(stdout, "ga %dx%d contradiction: %s\n", cfg->seqlen, cfg->colors,
+            mmGaGuess(cfg, pool, &csp, &prm, guess, &st) < 0 ? "no guess OK" : "a guess WRONG");
+    mmCspFree(&csp);
+}
+
+/* sampled against exact guess selection on the second move, with candidates as guesses */
+static void benchSample(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    static const int modes[] = {MM_MINIMAX, MM_ENTROPY};
+    struct mmGuessScore exact, picked;
+    struct mmEstimate est;
+    struct mmSampleStats st;
+    int *set, n, ng, counts[MM_MAX_FB], f, big = 0, g, ok;
+    unsigned i;
+    uint64_t t0, t1;
+
+    (void)pool;
+    if (cfg->ncodes == 0)
+        return;
+    set = (int *)malloc(cfg->ncodes * sizeof(int));
+    n = mmAllCodes(cfg, set);
+    // first guess 0..01..1, answered with the biggest class
+    mmPartitionCounts(cfg, cfg->colors - 1, set, n, counts);
+    for (f = 0; f < cfg->nfb; f++)
+        if (counts[f] > counts[big])
+            big = f;
+    n = mmFilter(cfg, set, n, cfg->colors - 1, big);
+    ng = n < 1000 ? n : 1000;
+
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+    {
+        t0 = timeInMicroseconds();
+        mmSelectGuess(cfg, modes[i], set, n, set, ng, &exact);
+        t1 = timeInMicroseconds();
+        g = mmSelectGuessSampled(cfg, modes[i], set, n, set, ng, 0, 1701, &est, &st);
+        mmScoreGuess(cfg, g, set, n, &picked);
+        // the exact score of the guess picked must lie within the bounds of its estimate
+        if (modes[i] == MM_ENTROPY)
+            ok = est.entropyLo <= picked.entropy + 1e-9 && picked.entropy <= est.entropyHi + 1e-9;
+        else
+            ok = est.worstLo <= picked.worst + 1e-9 && picked.worst <= est.worstHi + 1e-9;
+        fprintf(stdout, "sample %dx%d %-7s: %d candidates, %d guesses; exact %.3f ms, sampled %.3f ms "
+                        "(%d rounds, %d samples, %d left); best %s %.3f, picked %.3f [%.3f, %.3f] %s\n",
+                cfg->seqlen, cfg->colors, modes[i] == MM_ENTROPY ? "entropy" : "minimax", n, ng,
+                (t1 - t0) / 1000.0, st.usec / 1000.0, st.rounds, st.samples, st.left,
+                modes[i] == MM_ENTROPY ? "entropy" : "worst",
+                modes[i] == MM_ENTROPY ? exact.entropy : exact.worst,
+                modes[i] == MM_ENTROPY ? picked.entropy : picked.worst,
+                modes[i] == MM_ENTROPY ? est.entropyLo : est.worstLo,
+                modes[i] == MM_ENTROPY ? est.entropyHi : est.worstHi, ok ? "OK" : "WRONG");
+    }
+    free(set);
+}
+
+/* partition-histogram kernels: the scalar one against the game's countMatches(), the others
+   against the scalar one, and the codes each classifies per second */
+static void benchHistogram(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    static const char *names[] = {"scalar", "lanes", "simd"};
+    int counts[MM_MAX_FB], ref[MM_MAX_FB], ok = 1, n, reps, r, k, j;
+    uint8_t *codes = cfg->digits;
+    struct mmRng rng;
+    uint64_t t0;
+
+    (void)pool;
+    mmRngSeed(&rng, 1701);
+    // the whole code space if it is enumerated, otherwise random codes
+    n = cfg->ncodes;
+    if (codes == NULL)
+    {
+        n = 1 << 20;
+        codes = (uint8_t *)malloc((size_t)n * cfg->seqlen);
+        for (r = 0; r < n; r++)
+            randomCode(cfg, codes + (long)r * cfg->seqlen, &rng);
+    }
+
+    if (cfg->seqlen == GAME_SEQL && cfg->ncodes > 0)
+    {
+        int a[GAME_SEQL], b[GAME_SEQL];
+        for (r = 0; r < n && ok; r++)
+        {
+            memset(ref, 0, sizeof(ref));
+            mmCodeToSeq(cfg, r, a);
+            for (k = 0; k < n; k++)
+            {
+                int res;
+                mmCodeToSeq(cfg, k, b);
+                res = countMatches(a, b);
+                ref[mmFbId(cfg, res / 10, res % 10)]++;
+            }
+            mmHistogram(cfg, MM_HIST_SCALAR, codes + (long)r * cfg->seqlen, codes, n, counts);
+            ok = memcmp(counts, ref, cfg->nfb * sizeof(int)) == 0;
+        }
+        fprintf(stdout, "hist %dx%d scalar against countMatches: %s\n", cfg->seqlen, cfg->colors,
+                ok ? "OK" : "WRONG");
+    }
+
+    reps = n < (1 << 22) ? (1 << 22) / n : 1;
+    for (k = MM_HIST_SCALAR; k <= MM_HIST_SIMD; k++)
+    {
+        ok = 1;
+        t0 = timeInMicroseconds();
+        for (r = 0; r < reps; r++)
+            mmHistogram(cfg, k, codes + (long)(r % n) * cfg->seqlen, codes, n, counts);
+        t0 = timeInMicroseconds() - t0;
+        for (r = 0; r < 8 && k != MM_HIST_SCALAR; r++)
+        {
+            j = mmRngBelow(&rng, n);
+            mmHistogram(cfg, MM_HIST_SCALAR, codes + (long)j * cfg->seqlen, codes, n, ref);
+            mmHistogram(cfg, k, codes + (long)j * cfg->seqlen, codes, n, counts);
+            ok &= memcmp(counts, ref, cfg->nfb * sizeof(int)) == 0;
+        }
+        fprintf(stdout, "hist %dx%d %-6s %-4s: %d codes x %d guesses, %.1f M codes classified/s %s\n",
+                cfg->seqlen, cfg->colors, names[k], k == MM_HIST_SIMD ? mmHistogramSimd() : "", n, reps,
+                t0 ? (double)n * reps / t0 : 0.0, ok ? "OK" : "WRONG");
+    }
+    if (codes != cfg->digits)
+        free(codes);
+}
+
+/* candidate filtering: rescoring against the bitset index, on int sets and on bitsets, and
+   against the multiset groups, over the first moves of a few games with random guesses */
+/* mmFilter() as it is without an index: every code rescored */
+static int filterRescore(const struct mmConfig *cfg, int *set, int n, int guess, int fb)
+{
+    int k = 0;
+    for (int i = 0; i < n; i++)
+        if (mmFeedback(cfg, guess, set[i]) == fb)
+            set[k++] = set[i];
+    return k;
+}
+
+static void benchIndex(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    struct mmIndex ix;
+    struct mmMultiset ms;
+    int *a, *b, *d, *e, na, nb, nc, nd, ne, game, move, guess, secret, fb, ok = 1;
+    uint64_t *cand, t0, tRescore = 0, tSet = 0, tBits = 0, tMulti = 0, tFilter = 0;
+    struct mmRng rng;
+
+    (void)pool;
+    mmRngSeed(&rng, 1701);
+    t0 = timeInMicroseconds();
+    if (mmIndexInit(cfg, &ix) != 0)
+        return;
+    fprintf(stdout, "index %dx%d: %.1f MB built in %.3f ms\n", cfg->seqlen, cfg->colors,
+            mmIndexBytes(&ix) / 1048576.0, (timeInMicroseconds() - t0) / 1000.0);
+    t0 = timeInMicroseconds();
+    mmMultisetInit(cfg, &ms);
+    fprintf(stdout, "index %dx%d: %d multiset groups built in %.3f ms\n", cfg->seqlen, cfg->colors,
+            ms.ngroups, (timeInMicroseconds() - t0) / 1000.0);
+    a = (int *)malloc(cfg->ncodes * sizeof(int));
+    b = (int *)malloc(cfg->ncodes * sizeof(int));
+    d = (int *)malloc(cfg->ncodes * sizeof(int));
+    e = (int *)malloc(cfg->ncodes * sizeof(int));
+    cand = (uint64_t *)malloc(ix.words * sizeof(uint64_t));
+
+    for (game = 0; game < 20; game++)
+    {
+        secret = mmRngBelow(&rng, cfg->ncodes);
+        na = nb = nd = ne = mmAllCodes(cfg, a);
+        mmAllCodes(cfg, b);
+        mmAllCodes(cfg, d);
+        mmAllCodes(cfg, e);
+        mmIndexAll(&ix, cand);
+        for (move = 0; move < 4 && na > 1; move++)
+        {
+            guess = mmRngBelow(&rng, cfg->ncodes);
+            fb = mmFeedback(cfg, guess, secret);
+            t0 = timeInMicroseconds();
+            na = filterRescore(cfg, a, na, guess, fb);
+            tRescore += timeInMicroseconds() - t0;
+            // the index of the configuration, if it has one, once the set is big enough
+            t0 = timeInMicroseconds();
+            ne = mmFilter(cfg, e, ne, guess, fb);
+            tFilter += timeInMicroseconds() - t0;
+            t0 = timeInMicroseconds();
+            nb = mmIndexFilterSet(&ix, b, nb, guess, fb);
+            tSet += timeInMicroseconds() - t0;
+            t0 = timeInMicroseconds();
+            nc = mmIndexFilter(&ix, cand, guess, fb);
+            tBits += timeInMicroseconds() - t0;
+            t0 = timeInMicroseconds();
+            nd = mmMultisetFilter(&ms, d, nd, guess, fb);
+            tMulti += timeInMicroseconds() - t0;
+            ok &= na == nb && na == nc && na == nd && na == ne && memcmp(a, b, na * sizeof(int)) == 0 &&
+                  memcmp(a, d, na * sizeof(int)) == 0 && memcmp(a, e, na * sizeof(int)) == 0;
+        }
+    }
+    fprintf(stdout, "index %dx%d filtering: rescore %.3f ms, mmFilter %.3f ms (%s), index on sets %.3f ms, "
+                    "on bitsets %.3f ms, multisets %.3f ms %s\n",
+            cfg->seqlen, cfg->colors, tRescore / 1000.0, tFilter / 1000.0, cfg->index ? "indexed" : "rescoring",
+            tSet / 1000.0, tBits / 1000.0, tMulti / 1000.0, ok ? "OK" : "WRONG");
+
+    // the first answer of a game, over the whole code space
+    guess = mmRngBelow(&rng, cfg->ncodes);
+    fb = mmFeedback(cfg, guess, mmRngBelow(&rng, cfg->ncodes));
+    na = mmAllCodes(cfg, a);
+    t0 = timeInMicroseconds();
+    na = filterRescore(cfg, a, na, guess, fb);
+    tRescore = timeInMicroseconds() - t0;
+    ne = mmAllCodes(cfg, e);
+    t0 = timeInMicroseconds();
+    ne = mmFilter(cfg, e, ne, guess, fb);
+    fprintf(stdout, "index %dx%d first answer: rescore %.3f ms, mmFilter %.3f ms %s\n",
+            cfg->seqlen, cfg->colors, tRescore / 1000.0, (timeInMicroseconds() - t0) / 1000.0,
+            na == ne && memcmp(a, e, na * sizeof(int)) == 0 ? "OK" : "WRONG");
+    free(e);
+    free(d);
+    free(cand);
+    free(b);
+    free(a);
+    mmMultisetFree(&ms);
+    mmIndexFree(&ix);
+}
+
+/* out-of-core sets: filtering, partition counts and guess selection against the in-memory
+   ones over the first moves of a few games; on spaces too large to enumerate (with -x),
+   the first answer of a game over the whole space */
+static void benchStream(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    struct mmStream *s;
+    struct mmStreamStats st;
+    struct mmGuessScore sc, ref;
+    uint8_t secret[MM_MAX_SEQL], guess[MM_MAX_SEQL], *codes;
+    long counts[MM_MAX_FB], n;
+    int refCounts[MM_MAX_FB], *set, nset, game, move, fb, ng, g, f, ok = 1;
+    struct mmRng rng;
+    uint64_t t0;
+
+    if (cfg->ncodes == 0 && !exhaustive)
+    {
+        fprintf(stdout, "stream %dx%d: skipped (use -x)\n", cfg->seqlen, cfg->colors);
+        return;
+    }
+    mmRngSeed(&rng, 1701);
+    s = mmStreamCreate(cfg, streamDir, cfg->ncodes ? STREAM_SMALL_CAP : STREAM_LARGE_CAP);
+    if (s == NULL)
+    {
+        fprintf(stderr, "Cannot create an out-of-core set in %s\n", streamDir ? streamDir : "/tmp");
+        return;
+    }
+
+    if (cfg->ncodes == 0)
+    {
+        t0 = timeInMicroseconds();
+        n = mmStreamAll(s);
+        mmStreamStats(s, &st);
+        fprintf(stdout, "stream %dx%d: %ld codes written in %.3f s, %.1f MB in %ld chunks, %.1f MB resident\n",
+                cfg->seqlen, cfg->colors, n, (timeInMicroseconds() - t0) / 1e6, st.bytes / 1048576.0,
+                st.chunks, st.resident / 1048576.0);
+        randomCode(cfg, secret, &rng);
+        randomCode(cfg, guess, &rng);
+        t0 = timeInMicroseconds();
+        mmStreamCounts(s, guess, counts);
+        fb = mmScoreDigits(cfg, guess, secret);
+        fprintf(stdout, "stream %dx%d: partition counted in %.3f s, answer class of %ld codes\n", cfg->seqlen,
+                cfg->colors, (timeInMicroseconds() - t0) / 1e6, counts[fb]);
+        t0 = timeInMicroseconds();
+        n = mmStreamFilter(s, guess, fb);
+        mmStreamStats(s, &st);
+        fprintf(stdout, "stream %dx%d: filtered in %.3f s (%.3f s waiting for reads), %ld codes left in "
+                        "%.1f MB %s\n",
+                cfg->seqlen, cfg->colors, (timeInMicroseconds() - t0) / 1e6, st.ioWait / 1e6, n,
+                st.bytes / 1048576.0, n == counts[fb] ? "OK" : "WRONG");
+        mmStreamDestroy(s);
+        return;
+    }
+
+    set = (int *)malloc(cfg->ncodes * sizeof(int));
+    codes = (uint8_t *)malloc((size_t)cfg->ncodes * cfg->seqlen);
+    t0 = timeInMicroseconds();
+    for (game = 0; game < 5; game++)
+    {
+        g = mmRngBelow(&rng, cfg->ncodes);
+        memcpy(secret, cfg->digits + (long)g * cfg->seqlen, cfg->seqlen);
+        nset = mmAllCodes(cfg, set);
+        ok &= mmStreamAll(s) == nset;
+        for (move = 0; move < 3 && nset > 1; move++)
+        {
+            // pick among the first candidates, then play a random guess
+            ng = nset < 50 ? nset : 50;
+            n = mmStreamRead(s, codes, ng);
+            g = mmStreamSelect(s, pool, MM_MINIMAX, codes, (int)n, &sc);
+            mmSelectGuess(cfg, MM_MINIMAX, set, nset, set, ng, &ref);
+            ok &= g >= 0 && sc.worst == ref.worst && sc.parts == ref.parts;
+
+            g = mmRngBelow(&rng, cfg->ncodes);
+            memcpy(guess, cfg->digits + (long)g * cfg->seqlen, cfg->seqlen);
+            fb = mmScoreDigits(cfg, guess, secret);
+            mmStreamCounts(s, guess, counts);
+            mmPartitionCounts(cfg, g, set, nset, refCounts);
+            for (f = 0; f < cfg->nfb; f++)
+                ok &= counts[f] == refCounts[f];
+            nset = mmFilter(cfg, set, nset, g, fb);
+            ok &= mmStreamFilter(s, guess, fb) == nset;
+            ok &= mmStreamRead(s, codes, nset) == nset;
+            for (f = 0; f < nset; f++)
+                ok &= mmDigitsToCode(cfg, codes + (long)f * cfg->seqlen) == set[f];
+        }
+    }
+    mmStreamStats(s, &st);
+    fprintf(stdout, "stream %dx%d: 5 games in %.3f ms, %ld passes, %.1f KB read, %.1f KB written, "
+                    "%.1f KB resident %s\n",
+            cfg->seqlen, cfg->colors, (timeInMicroseconds() - t0) / 1000.0, st.passes, st.bytesRead / 1024.0,
+            st.bytesWritten / 1024.0, st.resident / 1024.0, ok ? "OK" : "WRONG");
+    free(codes);
+    free(set);
+    mmStreamDestroy(s);
+}
+
+/* static solver: a smallest set of guesses found with all guesses tried at each step on small
+   spaces, and with the best few otherwise; the answers are checked to tell all codes apart */
+static void benchStatic(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    static const int widths[] = {0, 2, 8};
+    struct mmStaticStats st;
+    int guesses[STATIC_MAX_GUESSES], k, a, b, j, distinct;
+    unsigned w;
+
+    if (cfg->ncodes == 0)
+        return;
+    for (w = 0; w < sizeof(widths) / sizeof(widths[0]); w++)
+    {
+        if (widths[w] == 0 && cfg->ncodes > STATIC_EXHAUSTIVE_MAX && !exhaustive)
+        {
+            fprintf(stdout, "static %dx%d width all: skipped (use -x)\n", cfg->seqlen, cfg->colors);
+            continue;
+        }
+        k = mmStaticSolve(cfg, pool, STATIC_MAX_GUESSES, widths[w], guesses, &st);
+        if (k < 0)
+        {
+            fprintf(stdout, "static %dx%d width %d: no set of up to %d guesses found, %.3f s\n", cfg->seqlen,
+                    cfg->colors, widths[w], STATIC_MAX_GUESSES, st.usec / 1e6);
+            continue;
+        }
+        // no two codes get the same answers to all the guesses
+        distinct = 1;
+        for (a = 0; a < cfg->ncodes && distinct; a++)
+            for (b = a + 1; b < cfg->ncodes && distinct; b++)
+            {
+                for (j = 0; j < k && mmFeedback(cfg, guesses[j], a) == mmFeedback(cfg, guesses[j], b); j++)
+                    ;
+                distinct = j < k;
+            }
+        fprintf(stdout, "static %dx%d width %d: %d guesses%s, %ld nodes, %ld guesses scored, %.3f s on %d threads %s\n",
+                cfg->seqlen, cfg->colors, widths[w], k, st.minimal ? " (minimal)" : "", st.nodes, st.evaluated,
+                st.usec / 1e6, mmPoolSize(pool), distinct ? "OK" : "WRONG");
+    }
+}
+
+/* no-repetition variant: the colour-mask kernel against the duplicate-aware ones on the codes
+   without a repeated colour, for the same results and the codes each classifies per second */
+static void benchUnique(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    static const char *names[] = {"scalar", "lanes", "simd"};
+    long n = mmUniqueCount(cfg), i;
+    struct mmUnique *codes;
+    uint8_t *digits;
+    int counts[MM_MAX_FB], ref[MM_MAX_FB], reps, r, k, ok = 1;
+    double rate[3], mine;
+    uint64_t t0;
+
+    (void)pool;
+    if (n == 0 || n > MM_MAX_CODES)
+        return;
+    codes = (struct mmUnique *)malloc(n * sizeof(struct mmUnique));
+    digits = (uint8_t *)malloc((size_t)n * cfg->seqlen);
+    mmUniqueAll(cfg, codes);
+    for (i = 0; i < n; i++)
+        for (k = 0; k < cfg->seqlen; k++)
+            digits[i * cfg->seqlen + k] = (codes[i].digits >> (4 * (cfg->seqlen - 1 - k))) & 15;
+
+    // every code has a distinct colour per position, and the same partitions as the scalar kernel
+    for (i = 0; i < n && ok; i++)
+        ok = mmPopcount16(codes[i].mask) == cfg->seqlen && (i == 0 || codes[i].digits > codes[i - 1].digits);
+    for (r = 0; r < 16 && ok; r++)
+    {
+        i = (long)r * (n / 16);
+        mmHistogram(cfg, MM_HIST_SCALAR, digits + i * cfg->seqlen, digits, (int)n, ref);
+        mmUniqueHistogram(cfg, &codes[i], codes, n, counts);
+        ok = memcmp(counts, ref, cfg->nfb * sizeof(int)) == 0;
+    }
+
+    reps = n < (1 << 22) ? (int)((1 << 22) / n) : 1;
+    for (k = MM_HIST_SCALAR; k <= MM_HIST_SIMD; k++)
+    {
+        t0 = timeInMicroseconds();
+        for (r = 0; r < reps; r++)
+            mmHistogram(cfg, k, digits + (r % n) * cfg->seqlen, digits, (int)n, counts);
+        t0 = timeInMicroseconds() - t0;
+        rate[k] = t0 ? (double)n * reps / t0 : 0.0;
+    }
+    t0 = timeInMicroseconds();
+    for (r = 0; r < reps; r++)
+        mmUniqueHistogram(cfg, &codes[r % n], codes, n, counts);
+    t0 = timeInMicroseconds() - t0;
+    mine = t0 ? (double)n * reps / t0 : 0.0;
+
+    fprintf(stdout, "unique %dx%d: %ld codes x %d guesses; masks %.1f M codes/s, ", cfg->seqlen, cfg->colors, n,
+            reps, mine);
+    for (k = MM_HIST_SCALAR; k <= MM_HIST_SIMD; k++)
+        fprintf(stdout, "%s %.1f (x%.1f), ", names[k], rate[k], rate[k] > 0 ? mine / rate[k] : 0.0);
+    fprintf(stdout, "%s\n", ok ? "OK" : "WRONG");
+
+    // against the game's countMatches(), on all pairs of codes
+    if (cfg->seqlen == GAME_SEQL)
+    {
+        int a[GAME_SEQL], b[GAME_SEQL], res;
+        long pairs = 0;
+        uint64_t tGame, tMask;
+
+        ok = 1;
+        t0 = timeInMicroseconds();
+        for (r = 0; r < reps; r++)
+            for (i = 0; i < n; i++)
+            {
+                for (k = 0; k < GAME_SEQL; k++)
+                {
+                    a[k] = digits[(r % n) * GAME_SEQL + k] + 1;
+                    b[k] = digits[i * GAME_SEQL + k] + 1;
+                }
+                res = countMatches(a, b);
+                pairs += res;
+            }
+        tGame = timeInMicroseconds() - t0;
+        t0 = timeInMicroseconds();
+        for (r = 0; r < reps; r++)
+            for (i = 0; i < n; i++)
+            {
+                res = mmUniqueScore(cfg, codes[r % n], codes[i]);
+                pairs -= mmFbExact(cfg, res) * 10 + mmFbApprox(cfg, res);
+            }
+        tMask = timeInMicroseconds() - t0;
+        fprintf(stdout, "unique %dx%d: countMatches %.3f ms, masks %.3f ms (x%.1f) %s\n", cfg->seqlen,
+                cfg->colors, tGame / 1000.0, tMask / 1000.0, tMask ? (double)tGame / tMask : 0.0,
+                pairs == 0 ? "OK" : "WRONG");
+    }
+    free(digits);
+    free(codes);
+}
+
+/* adversarial codemaker: a few strategies played against it, with the number of guesses each
+   needs and the slowest answer; the codes the player has left must be those of the codemaker */
+static void benchAdversary(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    static const char *names[] = {"consistent", "minimax", "entropy"};
+    struct mmAdversary adv;
+    struct mmGuessScore sc;
+    int *set, n, s, moves, guess, fb, ok;
+    uint64_t slowest, total;
+
+    (void)pool;
+    if (cfg->ncodes == 0)
+        return;
+    set = (int *)malloc(cfg->ncodes * sizeof(int));
+    for (s = 0; s < 3; s++)
+    {
+        if (mmAdversaryInit(&adv, cfg, NULL, 0, ADVERSARY_BUDGET) != 0)
+            break;
+        n = mmAllCodes(cfg, set);
+        slowest = total = 0;
+        ok = 1;
+        for (moves = 1;; moves++)
+        {
+            if (s == 0)
+                guess = set[0];
+            else
+                guess = mmSelectGuess(cfg, s == 1 ? MM_MINIMAX : MM_ENTROPY, set, n, NULL, 0, &sc);
+            fb = mmAdversaryAnswer(&adv, guess);
+            total += adv.usec;
+            if (adv.usec > slowest)
+                slowest = adv.usec;
+            n = mmFilter(cfg, set, n, guess, fb);
+            ok &= n == adv.n && memcmp(set, adv.set, n * sizeof(int)) == 0;
+            if (fb == cfg->winFb || !ok)
+                break;
+        }
+        fprintf(stdout, "adversary %dx%d %-10s: won in %d guesses; answers %.3f ms on average, %.3f ms at most %s\n",
+                cfg->seqlen, cfg->colors, names[s], moves, total / 1000.0 / moves, slowest / 1000.0,
+                ok && fb == cfg->winFb ? "OK" : "WRONG");
+        mmAdversaryFree(&adv);
+    }
+    free(set);
+}
+
+/* game engine: random guesses, some with a blank peg, answered by the engine and checked against
+   the scoring kernels (and countMatches() for the game's length), with or without repeated colours */
+static void benchGame(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    static const char *names[] = {"repeats", "no repeats"};
+    struct mmGame g;
+    uint8_t guess[MM_MAX_SEQL];
+    struct mmRng rng;
+    int v, j, fb, ok, blank;
+    long games, turns;
+    uint64_t t0, t;
+
+    (void)pool;
+    mmRngSeed(&rng, 1701);
+    for (v = 0; v < 2; v++)
+    {
+        if (mmGameInit(&g, cfg, v ? MM_GAME_NOREPEAT : 0, GAME_ATTEMPTS, 1701) != 0)
+            continue;
+        ok = 1;
+        games = 1;
+        for (turns = 0; turns < GAME_TURNS && ok; turns++)
+        {
+            randomCode(cfg, guess, &rng);
+            blank = mmRngBelow(&rng, 16) == 0;
+            if (blank)
+                guess[mmRngBelow(&rng, cfg->seqlen)] = cfg->colors;
+            fb = mmGameGuess(&g, guess);
+            if (!blank)
+                ok = fb == mmScoreDigits(cfg, g.secret, guess);
+            else if (cfg->seqlen == GAME_SEQL)
+            {
+                int a[GAME_SEQL], b[GAME_SEQL], res;
+                for (j = 0; j < GAME_SEQL; j++)
+                {
+                    a[j] = g.secret[j] + 1;
+                    b[j] = guess[j] < cfg->colors ? guess[j] + 1 : 0;
+                }
+                res = countMatches(a, b);
+                ok = fb == mmFbId(cfg, res / 10, res % 10);
+            }
+            ok &= (g.state == MM_GAME_WON) == (fb == cfg->winFb) &&
+                  (g.state != MM_GAME_LOST || g.attempts == GAME_ATTEMPTS);
+            if (g.state != MM_GAME_PLAYING)
+            {
+                ok &= mmGameGuess(&g, guess) == -1;
+                mmGameRestart(&g);
+                games++;
+            }
+        }
+
+        // the same turns again, unchecked, for the rate
+        mmGameInit(&g, cfg, v ? MM_GAME_NOREPEAT : 0, GAME_ATTEMPTS, 1701);
+        t0 = timeInMicroseconds();
+        for (turns = 0; turns < GAME_TURNS; turns++)
+        {
+            guess[turns % cfg->seqlen] = (guess[turns % cfg->seqlen] + 1) % cfg->colors;
+            mmGameGuess(&g, guess);
+            if (g.state != MM_GAME_PLAYING)
+                mmGameRestart(&g);
+        }
+        t = timeInMicroseconds() - t0;
+        fprintf(stdout, "game %dx%d %-10s: %ld games; %.1f M turns/s %s\n", cfg->seqlen, cfg->colors, names[v],
+                games, t ? (double)GAME_TURNS / t : 0.0, ok ? "OK" : "WRONG");
+        mmGameFree(&g);
+    }
+}
+
+/* event log: games on the engine, logged to a file that is then mapped and scanned; every
+   record must hold the answer of its guess to its secret, in the order of the turns */
+static void benchLog(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    char path[1024];
+    struct mmLog *log;
+    struct mmLogView v;
+    struct mmLogStats st;
+    struct mmGame g;
+    uint8_t guess[MM_MAX_SEQL] = {0};
+    long turns, games = 0;
+    uint64_t t, tScan;
+    int fd, k, fb, ok = 1;
+
+    (void)pool;
+    if (cfg->ncodes == 0)
+        return;
+    snprintf(path, sizeof(path), "%s/mm-bench-XXXXXX", streamDir ? streamDir : "/tmp");
+    if ((fd = mkstemp(path)) < 0 || (log = mmLogOpen(path, cfg, LOG_TURNS)) == NULL)
+    {
+        fprintf(stderr, "Cannot make an event log in %s\n", path);
+        if (fd >= 0)
+        {
+            close(fd);
+            unlink(path);
+        }
+        return;
+    }
+
+    mmGameInit(&g, cfg, 0, GAME_ATTEMPTS, 1701);
+    mmGameSetLog(&g, log);
+    t = timeInMicroseconds();
+    for (turns = 0; turns < LOG_TURNS; turns++)
+    {
+        guess[turns % cfg->seqlen] = (guess[turns % cfg->seqlen] + 1) % cfg->colors;
+        mmGameGuess(&g, guess);
+        if (g.state != MM_GAME_PLAYING)
+        {
+            mmGameRestart(&g);
+            games++;
+        }
+    }
+    t = timeInMicroseconds() - t;
+    mmGameFree(&g);
+    mmLogClose(log);
+
+    ok = mmLogMap(&v, fd) == 0;
+    close(fd);
+    unlink(path);
+    if (!ok)
+    {
+        fprintf(stdout, "log %dx%d: cannot be mapped WRONG\n", cfg->seqlen, cfg->colors);
+        return;
+    }
+    tScan = timeInMicroseconds();
+    mmLogScan(&v, &st);
+    tScan = timeInMicroseconds() - tScan;
+
+    for (long i = 0; i < v.count && ok; i++)
+    {
+        const struct mmLogRecord *r = &v.records[i];
+
+        fb = mmFeedback(cfg, r->guess, r->secret);
+        k = i == 0 || r->game != v.records[i - 1].game ? 1 : v.records[i - 1].attempt + 1;
+        ok = r->exact == mmFbExact(cfg, fb) && r->approx == mmFbApprox(cfg, fb) && r->attempt == k &&
+             (r->type == MM_LOG_WON) == (fb == cfg->winFb);
+    }
+    ok &= v.count == LOG_TURNS && st.records == LOG_TURNS && st.games == games && st.unfinished == 0 && v.dropped == 0;
+    fprintf(stdout, "log %dx%d: %ld records of %d bytes, %ld games; %.1f M turns/s logged, scan %.1f M records/s %s\n",
+            cfg->seqlen, cfg->colors, st.records, (int)sizeof(struct mmLogRecord), st.games,
+            t ? (double)LOG_TURNS / t : 0.0, tScan ? (double)st.records / tScan : 0.0, ok ? "OK" : "WRONG");
+    mmLogUnmap(&v);
+}
+
+/* tournament: each strategy against every secret; the optimal one is skipped where its tree
+   would be, and no strategy may fail to find a secret */
+static void tournamentRun(const struct mmConfig *cfg, struct mmPool *pool, const struct mmStrategy *s)
+{
+    struct mmTournamentStats st;
+
+    if (strcmp(s->name, "optimal") == 0 && cfg->ncodes > TREE_EXPECTED_MAX && !exhaustive)
+    {
+        fprintf(stdout, "tournament %dx%d %-10s: skipped (use -x)\n", cfg->seqlen, cfg->colors, s->name);
+        return;
+    }
+    if (mmTournament(cfg, pool, s, TOURNAMENT_ATTEMPTS, &st) != 0)
+    {
+        fprintf(stdout, "tournament %dx%d %-10s: cannot be set up\n", cfg->seqlen, cfg->colors, s->name);
+        return;
+    }
+    fprintf(stdout, "tournament %dx%d %-10s: mean %.4f, max %d, won %.2f%% in %d; %.3f ms CPU per game, "
+                    "%.3f s (set up %.3f s) on %d threads %s\n",
+            cfg->seqlen, cfg->colors, s->name,
+            st.games > st.failed ? (double)st.guesses / (st.games - st.failed) : 0.0, st.worst,
+            100.0 * st.won / st.games, TOURNAMENT_ATTEMPTS, st.cpuUsec / 1000.0 / st.games, st.usec / 1000000.0,
+            st.initUsec / 1000000.0, mmPoolSize(pool), st.games == cfg->ncodes && st.failed == 0 ? "OK" : "WRONG");
+}
+
+static void benchTournament(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    const struct mmStrategy *s;
+
+    if (cfg->ncodes == 0)
+        return;
+    for (int i = 0; (s = mmStrategyBuiltin(i)) != NULL; i++)
+        tournamentRun(cfg, pool, s);
+    if (pluginPath == NULL)
+        return;
+    if ((s = mmStrategyLoad(pluginPath)) == NULL)
+        fprintf(stderr, "Cannot load strategy plugin %s\n", pluginPath);
+    else
+        tournamentRun(cfg, pool, s);
+}
+
+/* sessions: many games stepped round robin on one thread by the built-in player; the answers
+   of every session are checked against its secret at the end */
+static void benchSession(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    struct mmSessionSet ss;
+    long i, steps;
+    int k, ok = 1;
+    uint64_t t;
+
+    (void)pool;
+    if (mmSessionsInit(&ss, cfg, SESSIONS, SESSION_ATTEMPTS, 1701) != 0)
+        return;
+    t = timeInMicroseconds();
+    steps = mmSessionsRun(&ss, SESSION_STEPS);
+    t = timeInMicroseconds() - t;
+
+    for (i = 0; i < ss.n && ok; i++)
+    {
+        const struct mmSession *s = &ss.sessions[i];
+        for (k = 0; k < s->attempts && ok; k++)
+            ok = s->fbs[k] == mmFeedback(cfg, s->guesses[k], s->secret) &&
+                 (k == 0 || s->guesses[k] > s->guesses[k - 1]);
+        ok &= s->state != MM_SESSION_WON || s->guesses[s->attempts - 1] == s->secret;
+    }
+    ok &= ss.steps == steps && ss.won > 0;
+    fprintf(stdout, "session %dx%d: %ld sessions of %d bytes (%.1f MB); %.1f M steps/s, %ld games won "
+                    "(avg %.3f), %ld lost %s\n",
+            cfg->seqlen, cfg->colors, ss.n, (int)sizeof(struct mmSession),
+            ss.n * sizeof(struct mmSession) / 1048576.0, t ? (double)steps / t : 0.0, ss.won,
+            ss.won ? (double)ss.guesses / ss.won : 0.0, ss.lost, ok ? "OK" : "WRONG");
+    mmSessionsFree(&ss);
+}
+
+/* a temporary file in the directory of -s (or /tmp), deleted at once */
+static int tempFile(void)
+{
+    char path[1024];
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/mm-bench-XXXXXX", streamDir ? streamDir : "/tmp");
+    if ((fd = mkstemp(path)) >= 0)
+        unlink(path);
+    return fd;
+}
+
+/* batch scoring: lines of two codes, some with extra spaces or a '\r' and some that are no codes,
+   through files; the output must be what the scalar scoring gives */
+static void benchBatch(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    struct mmBatchStats st;
+    uint8_t a[MM_MAX_SEQL], b[MM_MAX_SEQL];
+    struct mmRng rng;
+    char *in, *exp, *out, *p, *e;
+    int fdIn, fdOut, j, fb, ok;
+    long i;
+
+    if (cfg->colors > 9 || cfg->seqlen > 8)
+        return;
+    mmRngSeed(&rng, 1701);
+    in = (char *)malloc((long)BATCH_LINES * (2 * cfg->seqlen + 8));
+    exp = (char *)malloc((long)BATCH_LINES * 4);
+    for (i = 0, p = in, e = exp; i < BATCH_LINES; i++)
+    {
+        int kind = mmRngBelow(&rng, 64);
+
+        randomCode(cfg, a, &rng);
+        randomCode(cfg, b, &rng);
+        for (j = 0; j < cfg->seqlen; j++)
+            p[j] = '1' + a[j];
+        p += cfg->seqlen;
+        p += kind == 0 ? sprintf(p, "  ") : sprintf(p, " ");
+        for (j = 0; j < cfg->seqlen; j++)
+            p[j] = '1' + b[j];
+        // a colour that is not one, or a code one digit too short
+        if (kind == 1)
+            p[mmRngBelow(&rng, cfg->seqlen)] = mmRngBelow(&rng, 2) ? '0' + cfg->colors + 1 : 'x';
+        p += cfg->seqlen - (kind == 2);
+        p += kind == 3 ? sprintf(p, "\r\n") : sprintf(p, "\n");
+        if (kind == 1 || kind == 2)
+            e += sprintf(e, "ERR\n");
+        else
+        {
+            fb = mmScoreDigits(cfg, a, b);
+            e += sprintf(e, "%d %d\n", mmFbExact(cfg, fb), mmFbApprox(cfg, fb));
+        }
+    }
+
+    fdIn = tempFile();
+    fdOut = tempFile();
+    if (fdIn < 0 || fdOut < 0 || write(fdIn, in, p - in) != p - in)
+    {
+        fprintf(stderr, "Cannot write the input of the batch scorer\n");
+        return;
+    }
+    lseek(fdIn, 0, SEEK_SET);
+    ok = mmBatchScore(cfg, fdIn, fdOut, mmPoolSize(pool), &st) == 0;
+
+    out = (char *)malloc(e - exp + 1);
+    lseek(fdOut, 0, SEEK_SET);
+    ok &= st.bytesOut == e - exp && read(fdOut, out, e - exp) == e - exp && memcmp(out, exp, e - exp) == 0;
+    ok &= st.lines == BATCH_LINES;
+    fprintf(stdout, "batch %dx%d: %ld lines (%ld not codes), %.1f MB in %.3f s on %d threads: %.1f M lines/s, "
+                    "%.1f MB/s %s\n",
+            cfg->seqlen, cfg->colors, st.lines, st.errors, st.bytesIn / 1048576.0, st.usec / 1000000.0,
+            mmPoolSize(pool), st.usec ? (double)st.lines / st.usec : 0.0,
+            st.usec ? st.bytesIn / 1.048576 / st.usec : 0.0, ok ? "OK" : "WRONG");
+    close(fdIn);
+    close(fdOut);
+    free(in);
+    free(exp);
+    free(out);
+}
+
+/* a corpus of @count@ records of @kind@ written to a temporary file, and mapped back */
+static int corpusTemp(const struct mmConfig *cfg, int kind, const void *records, long count, struct mmCorpus *c)
+{
+    int fd = tempFile(), res;
+
+    if (fd < 0)
+        return -1;
+    res = mmCorpusWrite(fd, cfg, kind, records, count) == 0 && mmCorpusMap(c, fd) == 0 ? 0 : -1;
+    close(fd);
+    return res;
+}
+
+/* score the pairs of @c@, checked against the scalar scoring; the scored pairs must map back */
+static void corpusScore(const struct mmConfig *cfg, struct mmPool *pool, const struct mmCorpus *c)
+{
+    struct mmCorpusScored *out = (struct mmCorpusScored *)malloc(c->count * sizeof(struct mmCorpusScored));
+    const struct mmCorpusPair *in = (const struct mmCorpusPair *)c->records;
+    struct mmBatchStats st;
+    struct mmCorpus back;
+    long i, errors = 0;
+    int ok, fb;
+
+    ok = mmBatchScoreCorpus(cfg, pool, c, out, &st) == 0;
+    for (i = 0; i < c->count && ok; i++)
+    {
+        if (in[i].a >= (uint32_t)cfg->ncodes || in[i].b >= (uint32_t)cfg->ncodes)
+        {
+            ok = out[i].exact == MM_CORPUS_INVALID && out[i].approx == MM_CORPUS_INVALID;
+            errors++;
+            continue;
+        }
+        fb = mmScoreDigits(cfg, cfg->digits + (long)in[i].a * cfg->seqlen, cfg->digits + (long)in[i].b * cfg->seqlen);
+        ok = out[i].a == in[i].a && out[i].b == in[i].b && out[i].exact == mmFbExact(cfg, fb) &&
+             out[i].approx == mmFbApprox(cfg, fb);
+    }
+    ok &= errors == st.errors;
+    if (ok && corpusTemp(cfg, MM_CORPUS_SCORED, out, c->count, &back) == 0)
+    {
+        ok = back.kind == MM_CORPUS_SCORED && back.count == c->count &&
+             memcmp(back.records, out, c->count * sizeof(struct mmCorpusScored)) == 0;
+        mmCorpusUnmap(&back);
+    }
+    else
+        ok = 0;
+    fprintf(stdout, "corpus %dx%d: %ld pairs (%ld not codes), %.1f MB in %.3f s on %d threads: %.1f M pairs/s, "
+                    "%.1f MB/s %s\n",
+            cfg->seqlen, cfg->colors, st.lines, st.errors, st.bytesIn / 1048576.0, st.usec / 1000000.0,
+            mmPoolSize(pool), st.usec ? (double)st.lines / st.usec : 0.0,
+            st.usec ? st.bytesIn / 1.048576 / st.usec : 0.0, ok ? "OK" : "WRONG");
+    free(out);
+}
+
+/* play the codes of @c@ as secrets, with the minimax strategy */
+static void corpusPlay(const struct mmConfig *cfg, struct mmPool *pool, const struct mmCorpus *c)
+{
+    struct mmTournamentStats st;
+    int ok;
+
+    ok = mmTournamentSecrets(cfg, pool, mmStrategyFind("minimax"), TOURNAMENT_ATTEMPTS,
+                             (const uint32_t *)c->records, c->count, &st) == 0;
+    ok &= st.games == c->count && st.failed == 0;
+    fprintf(stdout, "corpus %dx%d: %ld secrets, minimax mean %.4f, max %d, won %.2f%% in %d; %.3f s on %d threads %s\n",
+            cfg->seqlen, cfg->colors, st.games, st.games > st.failed ? (double)st.guesses / (st.games - st.failed) : 0.0,
+            st.worst, st.games ? 100.0 * st.won / st.games : 0.0, TOURNAMENT_ATTEMPTS, st.usec / 1000000.0,
+            mmPoolSize(pool), ok ? "OK" : "WRONG");
+}
+
+/* binary corpora: random pairs (a few of them no codes) scored straight from the mapping, and
+   random secrets played in a tournament; or else the corpus of -f, if it is of this configuration */
+static void benchCorpus(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    struct mmCorpus c;
+    struct mmCorpusPair *pairs;
+    uint32_t *codes;
+    struct mmRng rng;
+    long i;
+    int fd;
+
+    if (cfg->ncodes == 0)
+        return;
+    if (corpusPath)
+    {
+        if ((fd = open(corpusPath, O_RDONLY)) < 0 || mmCorpusMap(&c, fd) != 0)
+        {
+            fprintf(stderr, "Cannot map the corpus %s\n", corpusPath);
+            if (fd >= 0)
+                close(fd);
+            return;
+        }
+        close(fd);
+        if (c.colors != cfg->colors || c.seqlen != cfg->seqlen)
+            fprintf(stdout, "corpus %dx%d: skipped (%s is for %dx%d)\n", cfg->seqlen, cfg->colors, corpusPath,
+                    c.seqlen, c.colors);
+        else if (c.kind == MM_CORPUS_PAIRS)
+            corpusScore(cfg, pool, &c);
+        else if (c.kind == MM_CORPUS_CODES)
+            corpusPlay(cfg, pool, &c);
+        mmCorpusUnmap(&c);
+        return;
+    }
+
+    mmRngSeed(&rng, 1701);
+    pairs = (struct mmCorpusPair *)malloc(BATCH_LINES * sizeof(struct mmCorpusPair));
+    for (i = 0; i < BATCH_LINES; i++)
+    {
+        pairs[i].a = mmRngBelow(&rng, cfg->ncodes);
+        pairs[i].b = mmRngBelow(&rng, cfg->ncodes);
+        if (mmRngBelow(&rng, 64) == 0)
+            pairs[i].b = cfg->ncodes + mmRngBelow(&rng, 4);
+    }
+    if (corpusTemp(cfg, MM_CORPUS_PAIRS, pairs, BATCH_LINES, &c) == 0)
+    {
+        corpusScore(cfg, pool, &c);
+        mmCorpusUnmap(&c);
+    }
+    else
+        fprintf(stderr, "Cannot write a corpus of pairs\n");
+    free(pairs);
+
+    codes = (uint32_t *)malloc(CORPUS_SECRETS * sizeof(uint32_t));
+    mmRngCodes(cfg, pool, 1702, codes, CORPUS_SECRETS);
+    if (corpusTemp(cfg, MM_CORPUS_CODES, codes, CORPUS_SECRETS, &c) == 0)
+    {
+        corpusPlay(cfg, pool, &c);
+        mmCorpusUnmap(&c);
+    }
+    else
+        fprintf(stderr, "Cannot write a corpus of codes\n");
+    free(codes);
+}
+
+/* random numbers: the bulk codes are the same on the pool as on one thread, draws of a colour are
+   uniform (a chi-square test), and the generator against rand_r(), on the same draws */
+static void benchRng(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    uint32_t *codes, *check;
+    long counts[MM_MAX_COLS + 1], i;
+    uint64_t t0, tRng, tRand, sum = 0;
+    double chi = 0, expect = (double)RNG_DRAWS / cfg->colors;
+    struct mmRng rng, jumped;
+    unsigned seed = 1701;
+    int ok;
+
+    memset(counts, 0, sizeof(counts));
+    mmRngSeed(&rng, 1701);
+    jumped = rng;
+    mmRngJump(&jumped);
+    ok = mmRngNext(&rng) != mmRngNext(&jumped);
+
+    t0 = timeInMicroseconds();
+    for (i = 0; i < RNG_DRAWS; i++)
+        counts[mmRngBelow(&rng, cfg->colors)]++;
+    tRng = timeInMicroseconds() - t0;
+    // 'rand_r() % n' only for the time; its counts are not checked
+    t0 = timeInMicroseconds();
+    for (i = 0; i < RNG_DRAWS; i++)
+        sum += rand_r(&seed) % cfg->colors;
+    tRand = timeInMicroseconds() - t0;
+    for (int c = 0; c < cfg->colors; c++)
+        chi += (counts[c] - expect) * (counts[c] - expect) / expect;
+    // far beyond the 0.999 quantile for up to 10 colours
+    ok = ok && counts[cfg->colors] == 0 && chi < 3.0 * cfg->colors + 20;
+    fprintf(stdout, "rng %dx%d: %.1fM colours/s (rand_r %.1fM/s, sum %llu), chi-square %.1f on %d colours\n",
+            cfg->seqlen, cfg->colors, tRng ? (double)RNG_DRAWS / tRng : 0.0, tRand ? (double)RNG_DRAWS / tRand : 0.0,
+            (unsigned long long)sum, chi, cfg->colors);
+
+    if (cfg->ncodes > 0)
+    {
+        codes = (uint32_t *)malloc(RNG_DRAWS * sizeof(uint32_t));
+        check = (uint32_t *)malloc(RNG_DRAWS * sizeof(uint32_t));
+        t0 = timeInMicroseconds();
+        ok = ok && mmRngCodes(cfg, pool, 1701, codes, RNG_DRAWS) == 0;
+        tRng = timeInMicroseconds() - t0;
+        ok = ok && mmRngCodes(cfg, NULL, 1701, check, RNG_DRAWS) == 0 &&
+             memcmp(codes, check, RNG_DRAWS * sizeof(uint32_t)) == 0;
+        for (i = 0; i < RNG_DRAWS && ok; i++)
+            ok = codes[i] < (uint32_t)cfg->ncodes;
+        fprintf(stdout, "rng %dx%d: %.1fM codes/s on %d threads\n", cfg->seqlen, cfg->colors,
+                tRng ? (double)RNG_DRAWS / tRng : 0.0, mmPoolSize(pool));
+        free(codes);
+        free(check);
+    }
+    fprintf(stdout, "rng %dx%d: %s\n", cfg->seqlen, cfg->colors, ok ? "OK" : "WRONG");
+}
+
+/* -------------------------------------------------------------------------- */
+
+struct bench
+{
+    const char *name;
+    void (*run)(const struct mmConfig *cfg, struct mmPool *pool);
+};
+
+static const struct bench benches[] = {
+    {"tree", benchTree},
+    {"sym", benchSymmetry},
+    {"anytime", benchAnytime},
+    {"csp", benchCsp},
+    {"ga", benchGa},
+    {"sample", benchSample},
+    {"hist", benchHistogram},
+    {"index", benchIndex},
+    {"stream", benchStream},
+    {"static", benchStatic},
+    {"unique", benchUnique},
+    {"adversary", benchAdversary},
+    {"game", benchGame},
+    {"log", benchLog},
+    {"tournament", benchTournament},
+    {"session", benchSession},
+    {"batch", benchBatch},
+    {"corpus", benchCorpus},
+    {"rng", benchRng},
+};
+#define NBENCHES (sizeof(benches) / sizeof(benches[0]))
+
+int main(int argc, char **argv)
+{
+    struct mmConfig cfg;
+    struct mmPool *pool;
+    const char *only = NULL;
+    int opt, colors = 0, seqlen = 0, threads = 0;
+    unsigned c, b;
+
+    while ((opt = getopt(argc, argv, "hvxb:c:f:l:m:p:s:t:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'v':
+            verbose = 1;
+            break;
+        case 'x':
+            exhaustive = 1;
+            break;
+        case 'b':
+            only = optarg;
+            break;
+        case 'c':
+            colors = atoi(optarg);
+            break;
+        case 'l':
+            seqlen = atoi(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'm':
+            memoDir = optarg;
+            break;
+        case 's':
+            streamDir = optarg;
+            break;
+        case 'p':
+            pluginPath = optarg;
+            break;
+        case 'f':
+            corpusPath = optarg;
+            break;
+        default: /* '?' */
+            fprintf(stderr, "Usage: %s [-h] [-v] [-x] [-b <bench>] [-c <colours> -l <length>] [-f <corpus>] [-m <dir>] [-p <plugin>] [-s <dir>] [-t <threads>]\n", argv[0]);
+            exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    pool = mmPoolCreate(threads);
+    for (c = 0; c < NCONFIGS; c++)
+    {
+        if (colors && seqlen && c > 0)
+            break;
+        if (mmConfigInit(&cfg, colors && seqlen ? colors : configs[c][0],
+                         colors && seqlen ? seqlen : configs[c][1]) != 0)
+        {
+            fprintf(stderr, "Invalid configuration\n");
+            exit(EXIT_FAILURE);
+        }
+        for (b = 0; b < NBENCHES; b++)
+            if (only == NULL || strcmp(only, benches[b].name) == 0)
+                benches[b].run(&cfg, pool);
+        mmConfigFree(&cfg);
+    }
+    mmPoolDestroy(pool);
+    return 0;
+}
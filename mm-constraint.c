@@ -0,0 +1,357 @@
+/*
+ * Constraint-propagation solver, for code spaces too large to enumerate.
+ *
+ * Instead of a list of consistent codes, the state is a set of domains:
+ * the colours still possible at each position, and bounds on how often
+ * each colour occurs in the secret. Every answer tightens them (see
+ * cspPropagate), and consistent codes are generated by a backtracking
+ * search that checks each guess of the history incrementally, so only
+ * partial codes that can still be completed are extended.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm-solver.h"
+
+/* ======================================================= */
+/* SECTION: history and propagation                        */
+/* ------------------------------------------------------- */
+
+void mmCspInit(struct mmCsp *csp, const struct mmConfig *cfg)
+{
+    memset(csp, 0, sizeof(*csp));
+    csp->colors = cfg->colors;
+    csp->seqlen = cfg->seqlen;
+    for (int j = 0; j < csp->seqlen; j++)
+    {
+        csp->dom[j] = (1u << csp->colors) - 1;
+        for (int c = 0; c < csp->colors; c++)
+            csp->order[j][c] = c;
+    }
+    for (int c = 0; c < csp->colors; c++)
+    {
+        csp->lo[c] = 0;
+        csp->hi[c] = csp->seqlen;
+    }
+}
+
+void mmCspFree(struct mmCsp *csp)
+{
+    free(csp->hist);
+    csp->hist = NULL;
+    csp->nhist = csp->cap = 0;
+}
+
+void mmCspShuffle(struct mmCsp *csp, uint64_t seed)
+{
+    struct mmRng r;
+
+    mmRngSeed(&r, seed);
+    for (int j = 0; j < csp->seqlen; j++)
+        for (int c = csp->colors - 1; c > 0; c--)
+        {
+            int k = mmRngBelow(&r, c + 1);
+            uint8_t t = csp->order[j][c];
+            csp->order[j][c] = csp->order[j][k];
+            csp->order[j][k] = t;
+        }
+}
+
+static int minInt(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+/* tighten the domains until nothing changes; returns -1 if no code is left */
+static int cspPropagate(struct mmCsp *csp)
+{
+    int changed = 1, c, j, h;
+
+    while (changed)
+    {
+        int sumLo = 0, sumHi = 0;
+        changed = 0;
+
+        // what each feedback says about colour counts and positions
+        for (h = 0; h < csp->nhist; h++)
+        {
+            const struct mmCspGuess *g = &csp->hist[h];
+            int total = g->exact + g->approx, maxOther, minOther, fixed = 0, open = 0;
+
+            for (c = 0; c < csp->colors; c++)
+            {
+                int k = g->count[c], lo, hi;
+                if (k == 0)
+                    continue;
+                // total = sum over colours of min(count in guess, count in secret)
+                maxOther = minOther = 0;
+                for (int d = 0; d < csp->colors; d++)
+                    if (d != c)
+                    {
+                        maxOther += minInt(g->count[d], csp->hi[d]);
+                        minOther += minInt(g->count[d], csp->lo[d]);
+                    }
+                lo = total - maxOther;
+                hi = total - minOther;
+                if (lo > k || hi < 0)
+                    return -1;
+                if (lo > csp->lo[c])
+                {
+                    csp->lo[c] = lo;
+                    changed = 1;
+                }
+                if (hi < k && hi < csp->hi[c])
+                {
+                    csp->hi[c] = hi;
+                    changed = 1;
+                }
+            }
+
+            // exact matches: positions that surely match, and those that still can
+            for (j = 0; j < csp->seqlen; j++)
+            {
+                uint32_t bit = 1u << g->code[j];
+                if (csp->dom[j] == bit)
+                    fixed++;
+                if (csp->dom[j] & bit)
+                    open++;
+            }
+            if (fixed > g->exact || open < g->exact)
+                return -1;
+            for (j = 0; j < csp->seqlen; j++)
+            {
+                uint32_t bit = 1u << g->code[j];
+                if (!(csp->dom[j] & bit) || csp->dom[j] == bit)
+                    continue;
+                if (fixed == g->exact)
+                    csp->dom[j] &= ~bit; // no other position can match
+                else if (open == g->exact)
+                    csp->dom[j] = bit; // every position that can match must
+                else
+                    continue;
+                changed = 1;
+            }
+        }
+
+        // colour counts against the positions that can hold them
+        for (c = 0; c < csp->colors; c++)
+        {
+            uint32_t bit = 1u << c;
+            int avail = 0, fixed = 0;
+            for (j = 0; j < csp->seqlen; j++)
+            {
+                if (csp->dom[j] & bit)
+                    avail++;
+                if (csp->dom[j] == bit)
+                    fixed++;
+            }
+            if (avail < csp->hi[c])
+            {
+                csp->hi[c] = avail;
+                changed = 1;
+            }
+            if (fixed > csp->lo[c])
+            {
+                csp->lo[c] = fixed;
+                changed = 1;
+            }
+            if (csp->lo[c] > csp->hi[c])
+                return -1;
+            for (j = 0; j < csp->seqlen; j++)
+            {
+                if (!(csp->dom[j] & bit) || csp->dom[j] == bit)
+                    continue;
+                if (csp->hi[c] == 0)
+                    csp->dom[j] &= ~bit;
+                else if (csp->lo[c] == avail)
+                    csp->dom[j] = bit;
+                else
+                    continue;
+                changed = 1;
+            }
+            sumLo += csp->lo[c];
+            sumHi += csp->hi[c];
+        }
+        if (sumLo > csp->seqlen || sumHi < csp->seqlen)
+            return -1;
+
+        // the counts of all colours add up to the sequence length
+        for (c = 0; c < csp->colors; c++)
+        {
+            int hi = csp->seqlen - (sumLo - csp->lo[c]);
+            int lo = csp->seqlen - (sumHi - csp->hi[c]);
+            if (hi < csp->hi[c])
+            {
+                csp->hi[c] = hi;
+                changed = 1;
+            }
+            if (lo > csp->lo[c])
+            {
+                csp->lo[c] = lo;
+                changed = 1;
+            }
+        }
+
+        for (j = 0; j < csp->seqlen; j++)
+            if (csp->dom[j] == 0)
+                return -1;
+    }
+    return 0;
+}
+
+int mmCspAdd(struct mmCsp *csp, const uint8_t *guess, int exact, int approx)
+{
+    struct mmCspGuess *g;
+    int cap;
+
+    if (csp->nhist == csp->cap)
+    {
+        // the history is kept as it was if it cannot grow
+        cap = csp->cap ? 2 * csp->cap : 16;
+        g = (struct mmCspGuess *)realloc(csp->hist, cap * sizeof(struct mmCspGuess));
+        if (g == NULL)
+            return -1;
+        csp->hist = g;
+        csp->cap = cap;
+    }
+    g = &csp->hist[csp->nhist++];
+    memset(g, 0, sizeof(*g));
+    memcpy(g->code, guess, csp->seqlen);
+    for (int j = 0; j < csp->seqlen; j++)
+        g->count[guess[j]]++;
+    g->exact = exact;
+    g->approx = approx;
+    if (cspPropagate(csp) != 0)
+    {
+        csp->failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+/* ======================================================= */
+/* SECTION: backtracking search                            */
+/* ------------------------------------------------------- */
+
+struct cspSearch
+{
+    const struct mmCsp *csp;
+    uint8_t code[MM_MAX_SEQL];
+    int count[MM_MAX_COLS];  // colours used so far
+    int *exact, *common;     // per history guess, matches of the partial code
+    int (*visit)(void *ctx, const uint8_t *code);
+    void *ctx;
+    long found, limit, nodes;
+    int stop;
+};
+
+/* can the partial code of length @len@ still be completed? */
+static int cspFeasible(const struct cspSearch *s, int len)
+{
+    const struct mmCsp *csp = s->csp;
+    int left = csp->seqlen - len, need = 0;
+
+    for (int c = 0; c < csp->colors; c++)
+        if (csp->lo[c] > s->count[c])
+            need += csp->lo[c] - s->count[c];
+    if (need > left)
+        return 0;
+    for (int h = 0; h < csp->nhist; h++)
+    {
+        const struct mmCspGuess *g = &csp->hist[h];
+        // matches only grow as positions are added, by at most one each
+        if (s->exact[h] > g->exact || s->exact[h] + left < g->exact)
+            return 0;
+        if (s->common[h] > g->exact + g->approx || s->common[h] + left < g->exact + g->approx)
+            return 0;
+    }
+    return 1;
+}
+
+static void cspExtend(struct cspSearch *s, int len)
+{
+    const struct mmCsp *csp = s->csp;
+    int h;
+
+    if (len == csp->seqlen)
+    {
+        s->found++;
+        if ((s->visit && s->visit(s->ctx, s->code)) || (s->limit && s->found >= s->limit))
+            s->stop = 1;
+        return;
+    }
+    for (int i = 0; i < csp->colors && !s->stop; i++)
+    {
+        int c = csp->order[len][i];
+        if (!(csp->dom[len] & (1u << c)) || s->count[c] >= csp->hi[c])
+            continue;
+        s->nodes++;
+
+        s->code[len] = c;
+        for (h = 0; h < csp->nhist; h++)
+        {
+            if (csp->hist[h].code[len] == c)
+                s->exact[h]++;
+            if (s->count[c] < csp->hist[h].count[c])
+                s->common[h]++;
+        }
+        s->count[c]++;
+
+        if (cspFeasible(s, len + 1))
+            cspExtend(s, len + 1);
+
+        s->count[c]--;
+        for (h = 0; h < csp->nhist; h++)
+        {
+            if (csp->hist[h].code[len] == c)
+                s->exact[h]--;
+            if (s->count[c] < csp->hist[h].count[c])
+                s->common[h]--;
+        }
+    }
+}
+
+long mmCspSearch(const struct mmCsp *csp, long limit, int (*visit)(void *ctx, const uint8_t *code),
+                 void *ctx, long *nodes)
+{
+    struct cspSearch s;
+
+    memset(&s, 0, sizeof(s));
+    s.csp = csp;
+    s.visit = visit;
+    s.ctx = ctx;
+    s.limit = limit;
+    s.exact = (int *)calloc(csp->nhist + 1, sizeof(int));
+    s.common = (int *)calloc(csp->nhist + 1, sizeof(int));
+    if (s.exact == NULL || s.common == NULL)
+    {
+        free(s.exact);
+        free(s.common);
+        if (nodes)
+            *nodes = 0;
+        return -1;
+    }
+    if (cspFeasible(&s, 0))
+        cspExtend(&s, 0);
+    free(s.exact);
+    free(s.common);
+    if (nodes)
+        *nodes = s.nodes;
+    return s.found;
+}
+
+static int cspKeepFirst(void *ctx, const uint8_t *code)
+{
+    const struct mmCsp *csp = ((void **)ctx)[0];
+    memcpy(((void **)ctx)[1], code, csp->seqlen);
+    return 1;
+}
+
+int mmCspFirst(const struct mmCsp *csp, uint8_t *code, long *nodes)
+{
+    void *ctx[2] = {(void *)csp, code};
+    return mmCspSearch(csp, 1, cspKeepFirst, ctx, nodes) == 1 ? 0 : -1;
+}
@@ -0,0 +1,130 @@
+/*
+ * Binary corpora: lists of codes, pairs of codes, or scored pairs, as
+ * fixed-width records after a small header, so a file is used as it is
+ * mapped, with nothing to parse.
+ *
+ * The header gives the configuration, the kind and number of records, and
+ * the size of one record; the records follow it, 64-byte aligned. Codes
+ * are code indices, so only enumerated configurations have corpora.
+ * Integers are in the byte order of the machine that wrote the file; a
+ * file from a machine of the other order fails on the magic number.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mm-solver.h"
+
+#define CORPUS_MAGIC 0x3153524f434d4d00ULL // "\0MMCORS1"
+#define CORPUS_VERSION 1
+
+struct corpusHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t kind;
+    int32_t colors, seqlen;
+    uint32_t recordSize;
+    uint32_t pad0;
+    uint64_t count;
+    uint8_t pad[24];
+};
+
+/* bytes of a record of @kind@, 0 if there is no such kind */
+static size_t corpusRecordSize(int kind)
+{
+    switch (kind)
+    {
+    case MM_CORPUS_CODES:
+        return sizeof(uint32_t);
+    case MM_CORPUS_PAIRS:
+        return sizeof(struct mmCorpusPair);
+    case MM_CORPUS_SCORED:
+        return sizeof(struct mmCorpusScored);
+    }
+    return 0;
+}
+
+int mmCorpusMap(struct mmCorpus *c, int fd)
+{
+    const struct corpusHeader *hdr;
+    struct stat sb;
+
+    memset(c, 0, sizeof(*c));
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(struct corpusHeader))
+        return -1;
+    c->mapBytes = sb.st_size;
+    c->map = mmap(NULL, c->mapBytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (c->map == MAP_FAILED)
+    {
+        c->map = NULL;
+        return -1;
+    }
+    hdr = (const struct corpusHeader *)c->map;
+    if (hdr->magic != CORPUS_MAGIC || hdr->version != CORPUS_VERSION || hdr->recordSize == 0 ||
+        hdr->recordSize != corpusRecordSize(hdr->kind) || hdr->colors < 1 || hdr->colors > MM_MAX_COLS ||
+        hdr->seqlen < 1 || hdr->seqlen > MM_MAX_SEQL ||
+        hdr->count > (c->mapBytes - sizeof(struct corpusHeader)) / hdr->recordSize)
+    {
+        mmCorpusUnmap(c);
+        return -1;
+    }
+    c->kind = hdr->kind;
+    c->colors = hdr->colors;
+    c->seqlen = hdr->seqlen;
+    c->count = hdr->count;
+    c->records = hdr + 1;
+    // the records are read once, from the first to the last
+    madvise(c->map, c->mapBytes, MADV_SEQUENTIAL);
+    return 0;
+}
+
+void mmCorpusUnmap(struct mmCorpus *c)
+{
+    if (c->map)
+        munmap(c->map, c->mapBytes);
+    memset(c, 0, sizeof(*c));
+}
+
+int mmCorpusWrite(int fd, const struct mmConfig *cfg, int kind, const void *records, long count)
+{
+    struct corpusHeader hdr;
+    const char *p;
+    size_t left;
+    ssize_t k;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = CORPUS_MAGIC;
+    hdr.version = CORPUS_VERSION;
+    hdr.kind = kind;
+    hdr.colors = cfg->colors;
+    hdr.seqlen = cfg->seqlen;
+    hdr.recordSize = corpusRecordSize(kind);
+    hdr.count = count;
+    if (hdr.recordSize == 0 || count < 0)
+        return -1;
+
+    for (int part = 0; part < 2; part++)
+    {
+        p = part == 0 ? (const char *)&hdr : (const char *)records;
+        left = part == 0 ? sizeof(hdr) : (size_t)count * hdr.recordSize;
+        while (left > 0)
+        {
+            k = write(fd, p, left);
+            if (k < 0 && errno == EINTR)
+                continue;
+            if (k <= 0)
+                return -1;
+            p += k;
+            left -= k;
+        }
+    }
+    return 0;
+}
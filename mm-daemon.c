@@ -0,0 +1,616 @@
+/*
+  Scoring and game daemon: a long-lived process on a Unix-domain socket, so
+  the feedback table, the optimal tree and the first guess are computed once
+  and stay warm, instead of once per process as with `./cw2 -u`.
+
+$ make daemon
+$ ./mm-daemon &                        # serve the game's 3x3 on /tmp/mm-daemon.sock
+$ ./mm-daemon -c 6 -l 4 -s /tmp/mm.sock &  # classic 4x6 MasterMind on another socket
+$ printf 'score 123 321\nnew\nguess 0 112\nsuggest 0\nstats\n' | ./mm-daemon -C
+
+  The protocol is one request per line, one reply per line, in order. A
+  sequence is written as its colours 1..colours, one character each (with
+  a..g for colours 10..16), as with `./cw2 -u`.
+
+    score <seq> <seq>   OK <exact> <approximate>
+    new                 OK <game>            a game with a random secret; once DAEMON_GAMES
+                                             games are kept, the number of a game that
+                                             was won or lost is given again
+    guess <game> <seq>  OK <exact> <approximate> playing|won|lost
+    suggest <game>      OK <seq>             the optimal guess while the game follows
+                                             the optimal tree, else a minimax guess,
+                                             on samples of the codes if they are many
+    stats               OK <requests> p50 <us> p90 <us> p99 <us> p999 <us> max <us>
+
+  A failed request gets `ERR <reason>`, e.g. `ERR too many games` for a new
+  game while all DAEMON_GAMES games are being played. All the requests that arrive in one
+  read are served in a batch, and their replies sent in one write; the
+  latency of a request is taken from the end of its read to its reply.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <poll.h>
+
+#include "mm-solver.h"
+
+// socket path, unless -s is given
+#define DAEMON_SOCKET "/tmp/mm-daemon.sock"
+// attempts in a game (ATTEMPTS in master-mind.c)
+#define DAEMON_ATTEMPTS 5
+// the optimal tree is computed at start up for at most this many codes
+#define DAEMON_TREE_MAX 4096
+// bytes of requests buffered per connection; a longer line is refused
+#define DAEMON_BUF 65536
+// events taken per epoll_wait
+#define DAEMON_EVENTS 64
+// latencies kept for the percentiles, the most recent ones
+#define DAEMON_LATENCIES 65536
+// games kept at once, over all connections; past that, finished ones are reused
+#define DAEMON_GAMES (1 << 18)
+// a minimax guess for more codes than this is chosen on samples of at most this many
+#define DAEMON_SAMPLES 1024
+
+// colours as written in requests and replies
+static const char colourChars[] = "123456789abcdefg";
+
+static int verbose = 0;
+static volatile sig_atomic_t stopping = 0;
+
+// the warm state, shared by all connections
+static struct mmConfig cfg;
+static struct mmTree tree;
+static int haveTree = 0, firstGuess;
+static int *scratch; // ncodes codes, for the suggestions
+static struct mmSession *games;
+static long ngames = 0, gamesCap = 0;
+static long gamesReuse = 0; // the next game to look at for reuse
+static struct mmRng rng;
+
+// latencies in nanoseconds, as a ring
+static uint64_t latencies[DAEMON_LATENCIES];
+static long nrequests = 0;
+
+struct daemonConn
+{
+    int fd;
+    char in[DAEMON_BUF + 1];
+    int inLen;
+    char *out;
+    size_t outLen, outCap;
+    int eof;
+    int lost; // a reply could not be buffered, so the connection is dropped
+};
+
+/* -------------------------------------------------------------------------- */
+
+static uint64_t daemonNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void daemonStop(int sig)
+{
+    (void)sig;
+    stopping = 1;
+}
+
+/* append a line to the replies of @c@ */
+static void daemonReply(struct daemonConn *c, const char *fmt, ...)
+{
+    va_list ap;
+    size_t cap;
+    char *out;
+    int len;
+
+    if (c->lost)
+        return;
+    for (;;)
+    {
+        va_start(ap, fmt);
+        len = vsnprintf(c->out + c->outLen, c->outCap - c->outLen, fmt, ap);
+        va_end(ap);
+        if (len >= 0 && c->outLen + len + 1 <= c->outCap)
+            break;
+        cap = c->outCap ? 2 * c->outCap + len : 4096;
+        if ((out = (char *)realloc(c->out, cap)) == NULL)
+        {
+            // the replies after it would be taken for its own
+            c->lost = 1;
+            return;
+        }
+        c->out = out;
+        c->outCap = cap;
+    }
+    c->outLen += len;
+    c->out[c->outLen++] = '\n';
+}
+
+/* parse a sequence of colours into a code index; -1 if it is not one */
+static int daemonParseSeq(const char *s)
+{
+    uint8_t digits[MM_MAX_SEQL];
+    const char *p;
+
+    if (s == NULL || (int)strlen(s) != cfg.seqlen)
+        return -1;
+    for (int j = 0; j < cfg.seqlen; j++)
+    {
+        if ((p = strchr(colourChars, s[j])) == NULL || p - colourChars >= cfg.colors)
+            return -1;
+        digits[j] = p - colourChars;
+    }
+    return mmDigitsToCode(&cfg, digits);
+}
+
+static const char *daemonFormatSeq(int code, char *buf)
+{
+    const uint8_t *d = cfg.digits + (long)code * cfg.seqlen;
+    for (int j = 0; j < cfg.seqlen; j++)
+        buf[j] = colourChars[d[j]];
+    buf[cfg.seqlen] = '\0';
+    return buf;
+}
+
+static struct mmSession *daemonGame(const char *id)
+{
+    char *end;
+    long g;
+
+    if (id == NULL)
+        return NULL;
+    g = strtol(id, &end, 10);
+    return *end == '\0' && end != id && g >= 0 && g < ngames ? &games[g] : NULL;
+}
+
+/* a minimax guess for the @n@ codes of @set@; on samples of them if they are many, so a
+   suggestion on a large configuration takes a fraction of a second rather than seconds */
+static int daemonMinimax(int *set, int n)
+{
+    struct mmGuessScore sc;
+    int guess = -1;
+
+    if (n > DAEMON_SAMPLES)
+        guess = mmSelectGuessSampled(&cfg, MM_MINIMAX, set, n, NULL, 0, DAEMON_SAMPLES, n, NULL, NULL);
+    return guess >= 0 ? guess : mmSelectGuess(&cfg, MM_MINIMAX, set, n, NULL, 0, &sc);
+}
+
+/* the optimal guess as long as @s@ followed the tree; else minimax over the codes still possible */
+static int daemonSuggest(const struct mmSession *s)
+{
+    int node = haveTree ? 0 : -1, n;
+
+    for (int k = 0; k < s->attempts && node >= 0; k++)
+        node = s->guesses[k] == mmTreeGuess(&tree, node) ? mmTreeNext(&tree, node, s->fbs[k]) : -1;
+    if (node >= 0)
+        return mmTreeGuess(&tree, node);
+    if (s->attempts == 0)
+        return firstGuess;
+
+    n = mmAllCodes(&cfg, scratch);
+    for (int k = 0; k < s->attempts; k++)
+        n = mmFilter(&cfg, scratch, n, s->guesses[k], s->fbs[k]);
+    return n <= 2 ? scratch[0] : daemonMinimax(scratch, n);
+}
+
+static int daemonCompare(const void *pa, const void *pb)
+{
+    uint64_t a = *(const uint64_t *)pa, b = *(const uint64_t *)pb;
+    return a < b ? -1 : a > b;
+}
+
+static void daemonStats(struct daemonConn *c)
+{
+    static const double ps[] = {0.5, 0.9, 0.99, 0.999};
+    static const char *names[] = {"p50", "p90", "p99", "p999"};
+    long n = nrequests < DAEMON_LATENCIES ? nrequests : DAEMON_LATENCIES;
+    uint64_t *sorted = (uint64_t *)malloc((n ? n : 1) * sizeof(uint64_t));
+    char line[256];
+    int len;
+
+    if (sorted == NULL)
+    {
+        daemonReply(c, "ERR out of memory");
+        return;
+    }
+    memcpy(sorted, latencies, n * sizeof(uint64_t));
+    qsort(sorted, n, sizeof(uint64_t), daemonCompare);
+    len = snprintf(line, sizeof(line), "OK %ld", nrequests);
+    for (int i = 0; i < 4; i++)
+        len += snprintf(line + len, sizeof(line) - len, " %s %.3f", names[i],
+                        n ? sorted[(long)(ps[i] * (n - 1))] / 1000.0 : 0.0);
+    snprintf(line + len, sizeof(line) - len, " max %.3f", n ? sorted[n - 1] / 1000.0 : 0.0);
+    daemonReply(c, "%s", line);
+    free(sorted);
+}
+
+/* the number of a new game: a fresh one while the table may grow, then one that was won or lost,
+   in turn; -1 if all are being played */
+static long daemonNewGame(void)
+{
+    struct mmSession *more;
+    long cap, g;
+
+    if (ngames < gamesCap)
+        return ngames++;
+    if (gamesCap < DAEMON_GAMES)
+    {
+        cap = gamesCap ? 2 * gamesCap : 1024;
+        if (cap > DAEMON_GAMES)
+            cap = DAEMON_GAMES;
+        if ((more = (struct mmSession *)realloc(games, cap * sizeof(struct mmSession))) != NULL)
+        {
+            games = more;
+            gamesCap = cap;
+            return ngames++;
+        }
+    }
+    for (long k = 0; k < ngames; k++)
+    {
+        g = gamesReuse;
+        gamesReuse = (gamesReuse + 1) % ngames;
+        if (games[g].state == MM_SESSION_WON || games[g].state == MM_SESSION_LOST)
+            return g;
+    }
+    return -1;
+}
+
+/* serve one request line */
+static void daemonRequest(struct daemonConn *c, char *line)
+{
+    static const char *states[] = {"new", "playing", "won", "lost"};
+    char *save, *cmd = strtok_r(line, " \t\r", &save);
+    char *a1 = strtok_r(NULL, " \t\r", &save), *a2 = strtok_r(NULL, " \t\r", &save);
+    char buf[MM_MAX_SEQL + 1];
+    struct mmSession *s;
+    int g1, g2, fb;
+    long g;
+
+    if (cmd == NULL)
+        daemonReply(c, "ERR empty request");
+    else if (strcmp(cmd, "score") == 0)
+    {
+        if ((g1 = daemonParseSeq(a1)) < 0 || (g2 = daemonParseSeq(a2)) < 0)
+            daemonReply(c, "ERR expected two sequences of %d colours in 1..%d", cfg.seqlen, cfg.colors);
+        else
+        {
+            fb = mmFeedback(&cfg, g1, g2);
+            daemonReply(c, "OK %d %d", mmFbExact(&cfg, fb), mmFbApprox(&cfg, fb));
+        }
+    }
+    else if (strcmp(cmd, "new") == 0)
+    {
+        if ((g = daemonNewGame()) < 0)
+            daemonReply(c, "ERR too many games");
+        else
+        {
+            mmSessionStart(&cfg, &games[g], &rng);
+            daemonReply(c, "OK %ld", g);
+        }
+    }
+    else if (strcmp(cmd, "guess") == 0)
+    {
+        if ((s = daemonGame(a1)) == NULL)
+            daemonReply(c, "ERR no such game");
+        else if ((g1 = daemonParseSeq(a2)) < 0)
+            daemonReply(c, "ERR expected a sequence of %d colours in 1..%d", cfg.seqlen, cfg.colors);
+        else if ((fb = mmSessionAnswer(&cfg, s, g1, DAEMON_ATTEMPTS)) < 0)
+            daemonReply(c, "ERR game over");
+        else
+            daemonReply(c, "OK %d %d %s", mmFbExact(&cfg, fb), mmFbApprox(&cfg, fb), states[s->state]);
+    }
+    else if (strcmp(cmd, "suggest") == 0)
+    {
+        if ((s = daemonGame(a1)) == NULL)
+            daemonReply(c, "ERR no such game");
+        else
+            daemonReply(c, "OK %s", daemonFormatSeq(daemonSuggest(s), buf));
+    }
+    else if (strcmp(cmd, "stats") == 0)
+        daemonStats(c);
+    else
+        daemonReply(c, "ERR unknown request %s", cmd);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* send what can be sent of the replies; returns -1 if the connection is broken */
+static int daemonFlush(struct daemonConn *c)
+{
+    size_t sent = 0;
+    ssize_t k;
+
+    while (sent < c->outLen)
+    {
+        k = write(c->fd, c->out + sent, c->outLen - sent);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (k < 0)
+            return -1;
+        sent += k;
+    }
+    memmove(c->out, c->out + sent, c->outLen - sent);
+    c->outLen -= sent;
+    return 0;
+}
+
+/* read what is there, and serve all the complete lines of it as one batch */
+static int daemonRead(struct daemonConn *c)
+{
+    ssize_t k;
+    uint64_t t0;
+    char *line, *nl;
+
+    while ((k = read(c->fd, c->in + c->inLen, DAEMON_BUF - c->inLen)) < 0 && errno == EINTR)
+        ;
+    if (k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return 0;
+    if (k <= 0)
+        c->eof = 1;
+    else
+        c->inLen += k;
+
+    t0 = daemonNow();
+    line = c->in;
+    while ((nl = memchr(line, '\n', c->in + c->inLen - line)) != NULL)
+    {
+        *nl = '\0';
+        daemonRequest(c, line);
+        latencies[nrequests++ % DAEMON_LATENCIES] = daemonNow() - t0;
+        line = nl + 1;
+    }
+    c->inLen -= line - c->in;
+    memmove(c->in, line, c->inLen);
+
+    if (c->inLen == DAEMON_BUF)
+    {
+        daemonReply(c, "ERR request too long");
+        return -1;
+    }
+    // the last request may end with the input instead of a newline
+    if (c->eof && c->inLen > 0)
+    {
+        c->in[c->inLen] = '\0';
+        daemonRequest(c, c->in);
+        latencies[nrequests++ % DAEMON_LATENCIES] = daemonNow() - t0;
+        c->inLen = 0;
+    }
+    return 0;
+}
+
+static void daemonClose(int ep, struct daemonConn *c)
+{
+    epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    free(c->out);
+    free(c);
+}
+
+static int daemonServe(const char *path)
+{
+    struct sockaddr_un addr;
+    struct epoll_event ev, events[DAEMON_EVENTS];
+    int lfd, ep, n;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if ((lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 ||
+        bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lfd, SOMAXCONN) < 0)
+    {
+        fprintf(stderr, "Cannot listen on %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    ep = epoll_create1(EPOLL_CLOEXEC);
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL; // the listening socket
+    epoll_ctl(ep, EPOLL_CTL_ADD, lfd, &ev);
+    if (verbose)
+        fprintf(stderr, "Listening on %s\n", path);
+
+    while (!stopping)
+    {
+        if ((n = epoll_wait(ep, events, DAEMON_EVENTS, -1)) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            struct daemonConn *c = (struct daemonConn *)events[i].data.ptr;
+            int fd;
+
+            if (c == NULL)
+            {
+                while ((fd = accept(lfd, NULL, NULL)) >= 0)
+                {
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                    fcntl(fd, F_SETFD, FD_CLOEXEC);
+                    if ((c = (struct daemonConn *)calloc(1, sizeof(struct daemonConn))) == NULL)
+                    {
+                        close(fd);
+                        continue;
+                    }
+                    c->fd = fd;
+                    ev.events = EPOLLIN;
+                    ev.data.ptr = c;
+                    epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+                }
+                continue;
+            }
+            if ((events[i].events & EPOLLIN) && daemonRead(c) != 0)
+                c->eof = 1;
+            if (c->lost || daemonFlush(c) != 0 || (c->eof && c->outLen == 0) || (events[i].events & EPOLLERR))
+            {
+                daemonClose(ep, c);
+                continue;
+            }
+            // wait for room to send the rest of the replies
+            ev.events = c->outLen ? EPOLLOUT : EPOLLIN;
+            ev.data.ptr = c;
+            epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev);
+        }
+    }
+    close(ep);
+    close(lfd);
+    unlink(path);
+    return 0;
+}
+
+/* client: send the requests on stdin, and print the replies as they come, so that neither
+   side waits on the other with a full buffer; stdin is only read when it has input, so the
+   reply to a line typed in shows before the next one is typed */
+static int daemonClient(const char *path)
+{
+    struct sockaddr_un addr;
+    struct pollfd pfd[2];
+    char in[DAEMON_BUF], out[DAEMON_BUF];
+    ssize_t k, pending = 0, sent = 0;
+    int fd, input = 1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        fprintf(stderr, "Cannot connect to %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    for (;;)
+    {
+        // stdin is only watched once what was read from it is sent; a negative fd is ignored
+        pfd[0].fd = input && sent == pending ? STDIN_FILENO : -1;
+        pfd[0].events = POLLIN;
+        pfd[1].fd = fd;
+        pfd[1].events = POLLIN | (sent < pending ? POLLOUT : 0);
+        if (poll(pfd, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (pfd[0].revents & (POLLIN | POLLHUP | POLLERR))
+        {
+            sent = 0;
+            if ((pending = read(STDIN_FILENO, in, sizeof(in))) <= 0)
+            {
+                pending = 0;
+                input = 0;
+                shutdown(fd, SHUT_WR);
+            }
+        }
+        if ((pfd[1].revents & POLLOUT) && (k = write(fd, in + sent, pending - sent)) > 0)
+            sent += k;
+        if (pfd[1].revents & (POLLIN | POLLHUP))
+        {
+            if ((k = read(fd, out, sizeof(out))) == 0)
+                break;
+            if (k > 0)
+            {
+                fwrite(out, 1, k, stdout);
+                fflush(stdout);
+            }
+        }
+    }
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = DAEMON_SOCKET;
+    int opt, colors = 3, seqlen = 3, client = 0;
+    struct sigaction sa;
+
+    while ((opt = getopt(argc, argv, "hvCc:l:s:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'v':
+            verbose = 1;
+            break;
+        case 'C':
+            client = 1;
+            break;
+        case 'c':
+            colors = atoi(optarg);
+            break;
+        case 'l':
+            seqlen = atoi(optarg);
+            break;
+        case 's':
+            path = optarg;
+            break;
+        default: /* '?' */
+            fprintf(stderr, "Usage: %s [-h] [-v] [-C] [-c <colours> -l <length>] [-s <socket>]\n", argv[0]);
+            exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    if (client)
+        return daemonClient(path) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    if (mmConfigInit(&cfg, colors, seqlen) != 0 || cfg.ncodes == 0 || cfg.ncodes > MM_SESSION_MAX_CODES)
+    {
+        fprintf(stderr, "Invalid configuration\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // the caches: the feedback table (in cfg), the optimal tree and the first minimax guess
+    if (cfg.ncodes <= DAEMON_TREE_MAX)
+    {
+        struct mmPool *pool = mmPoolCreate(0);
+        struct mmTreeStats st;
+
+        haveTree = mmTreeSolve(&cfg, pool, MM_EXPECTED, NULL, &tree, &st) == 0;
+        mmPoolDestroy(pool);
+        if (verbose && haveTree)
+            fprintf(stderr, "Optimal tree: %.4f guesses on average (%.3f s)\n", (double)tree.total / cfg.ncodes,
+                    st.usec / 1000000.0);
+    }
+    scratch = (int *)malloc(cfg.ncodes * sizeof(int));
+    if (scratch == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    firstGuess = daemonMinimax(scratch, mmAllCodes(&cfg, scratch));
+    mmRngSeed(&rng, ((uint64_t)time(NULL) << 32) ^ getpid());
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = daemonStop;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    opt = daemonServe(path);
+    if (haveTree)
+        mmTreeFree(&tree);
+    free(scratch);
+    free(games);
+    mmConfigFree(&cfg);
+    return opt == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
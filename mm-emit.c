@@ -0,0 +1,94 @@
+/*
+ * Output of match results, "<n> exact" and "<n> approximate" lines as
+ * printed by showMatches(), without printf or malloc.
+ *
+ * The lines go into the fixed buffer of an emitter, with the digits of a
+ * number copied from a table of all two-digit numbers, and the buffer goes
+ * out with one write() when it is full or flushed. As it bypasses stdio,
+ * stdout must be flushed before the emitter writes to the same file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <errno.h>
+
+#include "mm-solver.h"
+
+// the digits of 0..99, two per number
+static const char emitDigits[] = "00010203040506070809"
+                                 "10111213141516171819"
+                                 "20212223242526272829"
+                                 "30313233343536373839"
+                                 "40414243444546474849"
+                                 "50515253545556575859"
+                                 "60616263646566676869"
+                                 "70717273747576777879"
+                                 "80818283848586878889"
+                                 "90919293949596979899";
+
+void mmEmitInit(struct mmEmitter *e, int fd)
+{
+    e->fd = fd;
+    e->len = 0;
+    e->error = 0;
+}
+
+/* append the decimal digits of @v@, two at a time from the table */
+static char *emitNumber(char *p, int v)
+{
+    unsigned u = v < 0 ? 0u - (unsigned)v : (unsigned)v;
+
+    if (v < 0)
+        *p++ = '-';
+    if (u >= 100)
+    {
+        p = emitNumber(p, (int)(u / 100));
+        u %= 100;
+        *p++ = emitDigits[2 * u];
+    }
+    else if (u >= 10)
+        *p++ = emitDigits[2 * u];
+    *p++ = emitDigits[2 * u + 1];
+    return p;
+}
+
+void mmEmitMatches(struct mmEmitter *e, int exact, int approx)
+{
+    char *p;
+
+    if (e->len + MM_EMIT_MAX_MATCHES > sizeof(e->buf))
+        mmEmitFlush(e);
+    p = e->buf + e->len;
+    p = emitNumber(p, exact);
+    memcpy(p, " exact\n", 7);
+    p = emitNumber(p + 7, approx);
+    memcpy(p, " approximate\n", 13);
+    e->len = p + 13 - e->buf;
+}
+
+int mmEmitFlush(struct mmEmitter *e)
+{
+    const char *p = e->buf;
+    size_t left = e->len;
+    ssize_t k;
+
+    while (left > 0 && !e->error)
+    {
+        k = write(e->fd, p, left);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            e->error = 1;
+        else
+        {
+            p += k;
+            left -= k;
+        }
+    }
+    e->len = 0;
+    return e->error ? -1 : 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * Headless game engine: the state and rules of one game, with no I/O and
+ * no delays, so the front-ends in master-mind.c only read guesses and show
+ * answers, and games can be played by the million for simulation.
+ *
+ * A guess is a sequence of 0-based colours; a colour out of range is a
+ * blank peg that matches nothing, as the terminal reads an unknown letter.
+ * With MM_GAME_ADVERSARY, the answers come from an adversarial codemaker
+ * (see mm-adversary.c) and the secret follows them, until a guess with a
+ * blank peg fixes it. With a log (see mm-log.c), each answer is recorded
+ * with the time taken to make the guess and to answer it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm-solver.h"
+
+/* ======================================================= */
+/* SECTION: secrets and scoring                            */
+/* ------------------------------------------------------- */
+
+/* a random secret; with MM_GAME_NOREPEAT, no colour occurs twice */
+static void gameDraw(struct mmGame *g)
+{
+    mmRngDigits(&g->rng, g->cfg, g->flags & MM_GAME_NOREPEAT, g->secret);
+}
+
+/* feedback id of @guess@ against the secret; blank pegs count neither as exact nor as a colour */
+static int gameScore(const struct mmGame *g, const uint8_t *guess, int blanks)
+{
+    const struct mmConfig *cfg = g->cfg;
+    int cs[MM_MAX_COLS] = {0}, cg[MM_MAX_COLS] = {0};
+    int exact = 0, common = 0;
+
+    if (!blanks)
+        return g->flags & MM_GAME_NOREPEAT
+                   ? mmUniqueScore(cfg, mmUniquePack(cfg, g->secret), mmUniquePack(cfg, guess))
+                   : mmScoreDigits(cfg, g->secret, guess);
+
+    for (int j = 0; j < cfg->seqlen; j++)
+    {
+        cs[g->secret[j]]++;
+        if (guess[j] >= cfg->colors)
+            continue;
+        cg[guess[j]]++;
+        if (guess[j] == g->secret[j])
+            exact++;
+    }
+    for (int c = 0; c < cfg->colors; c++)
+        common += cs[c] < cg[c] ? cs[c] : cg[c];
+    return mmFbId(cfg, exact, common - exact);
+}
+
+/* the codemaker starts from all the secrets that could have been drawn */
+static int gameAdversaryInit(struct mmGame *g)
+{
+    int *set, n, res;
+
+    if (!(g->flags & MM_GAME_NOREPEAT))
+        return mmAdversaryInit(&g->adv, g->cfg, NULL, 0, MM_GAME_BUDGET);
+    set = (int *)malloc(g->cfg->ncodes * sizeof(int));
+    if (set == NULL)
+        return -1;
+    n = mmUniqueCodes(g->cfg, set);
+    res = mmAdversaryInit(&g->adv, g->cfg, set, n, MM_GAME_BUDGET);
+    free(set);
+    return res;
+}
+
+/* code index of the digits @d@ for the log; -1 with a blank peg, or if codes are too many to index */
+static int32_t gameLogCode(const struct mmConfig *cfg, const uint8_t *d)
+{
+    int64_t code = 0;
+
+    for (int j = 0; j < cfg->seqlen; j++)
+    {
+        if (d[j] >= cfg->colors)
+            return -1;
+        code = code * cfg->colors + d[j];
+        if (code > INT32_MAX)
+            return -1;
+    }
+    return (int32_t)code;
+}
+
+/* append the answer @fb@ to @guess@, asked for at @t0@, to the log */
+static void gameLog(struct mmGame *g, const uint8_t *guess, int fb, uint64_t t0)
+{
+    const struct mmConfig *cfg = g->cfg;
+    uint64_t now = timeInMicroseconds();
+    struct mmLogRecord r;
+
+    if (g->attempts == 1)
+        g->logGame = mmLogGame(g->log);
+    r.usec = now;
+    r.game = g->logGame;
+    r.secret = gameLogCode(cfg, g->secret);
+    r.guess = gameLogCode(cfg, guess);
+    r.type = g->state == MM_GAME_WON ? MM_LOG_WON : g->state == MM_GAME_LOST ? MM_LOG_LOST : MM_LOG_GUESS;
+    r.attempt = g->attempts < 255 ? g->attempts : 255;
+    r.exact = mmFbExact(cfg, fb);
+    r.approx = mmFbApprox(cfg, fb);
+    r.thinkUsec = t0 - g->logUsec;
+    r.answerUsec = now - t0;
+    mmLogAppend(g->log, &r);
+    g->logUsec = now;
+}
+
+/* ======================================================= */
+/* SECTION: games                                          */
+/* ------------------------------------------------------- */
+
+int mmGameInit(struct mmGame *g, const struct mmConfig *cfg, int flags, int maxAttempts, uint64_t seed)
+{
+    memset(g, 0, sizeof(*g));
+    if (cfg->colors < 1 || cfg->colors > MM_MAX_COLS || cfg->seqlen < 1 || cfg->seqlen > MM_MAX_SEQL)
+        return -1;
+    if ((flags & MM_GAME_NOREPEAT) && cfg->seqlen > cfg->colors)
+        return -1;
+    // the adversary keeps the secrets as an enumerated set
+    if ((flags & MM_GAME_ADVERSARY) && cfg->ncodes == 0)
+        return -1;
+    g->cfg = cfg;
+    g->flags = flags;
+    g->maxAttempts = maxAttempts;
+    mmRngSeed(&g->rng, seed);
+    return mmGameRestart(g);
+}
+
+void mmGameFree(struct mmGame *g)
+{
+    mmAdversaryFree(&g->adv);
+}
+
+int mmGameRestart(struct mmGame *g)
+{
+    if (g->log)
+        g->logUsec = timeInMicroseconds();
+    g->attempts = 0;
+    g->state = MM_GAME_PLAYING;
+    g->lastFb = -1;
+    gameDraw(g);
+    if (g->flags & MM_GAME_ADVERSARY)
+    {
+        mmAdversaryFree(&g->adv);
+        return gameAdversaryInit(g);
+    }
+    return 0;
+}
+
+int mmGameSetSecret(struct mmGame *g, const uint8_t *secret)
+{
+    const struct mmConfig *cfg = g->cfg;
+    uint32_t used = 0;
+
+    // the adversary's secret follows its answers; a fixed one would be another game
+    if (g->attempts > 0 || (g->flags & MM_GAME_ADVERSARY))
+        return -1;
+    for (int j = 0; j < cfg->seqlen; j++)
+    {
+        if (secret[j] >= cfg->colors)
+            return -1;
+        if ((g->flags & MM_GAME_NOREPEAT) && (used & (1u << secret[j])))
+            return -1;
+        used |= 1u << secret[j];
+    }
+    memcpy(g->secret, secret, cfg->seqlen);
+    return 0;
+}
+
+int mmGameOutcome(const struct mmConfig *cfg, int fb, int attempts, int maxAttempts)
+{
+    if (fb == cfg->winFb)
+        return MM_GAME_WON;
+    if (maxAttempts && attempts >= maxAttempts)
+        return MM_GAME_LOST;
+    return MM_GAME_PLAYING;
+}
+
+int mmGameGuess(struct mmGame *g, const uint8_t *guess)
+{
+    const struct mmConfig *cfg = g->cfg;
+    int blanks = 0, fb;
+    uint64_t t0 = g->log ? timeInMicroseconds() : 0;
+
+    if (g->state != MM_GAME_PLAYING)
+        return -1;
+    for (int j = 0; j < cfg->seqlen; j++)
+        blanks += guess[j] >= cfg->colors;
+
+    // a guess with a blank peg is no code the codemaker can answer to; the secret is fixed from then on
+    if (g->adv.n > 0 && blanks)
+        mmAdversaryFree(&g->adv);
+    if (g->adv.n > 0)
+    {
+        fb = mmAdversaryAnswer(&g->adv, mmDigitsToCode(cfg, guess));
+        memcpy(g->secret, cfg->digits + (long)g->adv.set[0] * cfg->seqlen, cfg->seqlen);
+    }
+    else
+        fb = gameScore(g, guess, blanks);
+
+    g->attempts++;
+    g->lastFb = fb;
+    g->state = mmGameOutcome(cfg, fb, g->attempts, g->maxAttempts);
+    if (g->log)
+        gameLog(g, guess, fb, t0);
+    return fb;
+}
+
+void mmGameSetLog(struct mmGame *g, struct mmLog *log)
+{
+    g->log = log;
+    g->logUsec = timeInMicroseconds();
+    // a game under way gets its number now; a new one, at its first guess
+    if (log && g->attempts > 0)
+        g->logGame = mmLogGame(log);
+}
@@ -0,0 +1,264 @@
+/*
+ * Genetic-algorithm guesser, for code spaces too large to enumerate.
+ *
+ * A population of codes is evolved towards consistency with the history:
+ * the fitness of a code is how far the answers it would have got differ
+ * from the real ones, summed over the history (0 means consistent). The
+ * fitness of a generation is computed with the batch scorer, in chunks
+ * spread over the work pool. Consistent codes found along the way are
+ * collected, and the one that splits the others best is played.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm-solver.h"
+
+// codes per fitness task on the work pool
+#define GA_CHUNK 256
+// codes competing in a tournament selection
+#define GA_TOURNAMENT 3
+// while no consistent code is found, go on for up to this many times maxGen generations
+#define GA_PATIENCE 4
+// whatever the limits, stop after this many generations in a row that find no new consistent
+// code, or GA_PATIENCE times as many if none was found at all: late in a game, there may be
+// fewer consistent codes than maxEligible
+#define GA_STALL 100
+
+struct gaState
+{
+    const struct mmConfig *cfg;
+    const struct mmCsp *csp;
+    int pop;
+    uint8_t *codes; // pop * seqlen
+    int *fitness;
+    uint8_t *scratch; // GA_CHUNK feedback ids per worker
+};
+
+/* a random code, taking each colour from the domain of its position; no domain may be empty */
+static void gaRandomCode(const struct mmCsp *csp, uint8_t *code, struct mmRng *r)
+{
+    for (int j = 0; j < csp->seqlen; j++)
+    {
+        int n = __builtin_popcount(csp->dom[j]), k = mmRngBelow(r, n), c;
+        for (c = 0; !(csp->dom[j] & (1u << c)) || k-- > 0; c++)
+            ;
+        code[j] = c;
+    }
+}
+
+static void gaFitnessTask(void *ctx, int chunk, int worker)
+{
+    struct gaState *ga = (struct gaState *)ctx;
+    const struct mmConfig *cfg = ga->cfg;
+    int start = chunk * GA_CHUNK, n = ga->pop - start < GA_CHUNK ? ga->pop - start : GA_CHUNK;
+    uint8_t *fb = ga->scratch + (long)worker * GA_CHUNK;
+
+    memset(ga->fitness + start, 0, n * sizeof(int));
+    for (int h = 0; h < ga->csp->nhist; h++)
+    {
+        const struct mmCspGuess *g = &ga->csp->hist[h];
+        mmScoreBatch(cfg, g->code, ga->codes + (long)start * cfg->seqlen, n, fb);
+        for (int i = 0; i < n; i++)
+            ga->fitness[start + i] += abs(mmFbExact(cfg, fb[i]) - g->exact) +
+                                      abs(mmFbApprox(cfg, fb[i]) - g->approx);
+    }
+}
+
+static int gaTournament(const struct gaState *ga, struct mmRng *r)
+{
+    int best = mmRngBelow(r, ga->pop);
+    for (int t = 1; t < GA_TOURNAMENT; t++)
+    {
+        int i = mmRngBelow(r, ga->pop);
+        if (ga->fitness[i] < ga->fitness[best])
+            best = i;
+    }
+    return best;
+}
+
+/* crossover of two parents, then a mutation, a swap of two positions, or an inversion */
+static void gaBreed(const struct gaState *ga, const uint8_t *a, const uint8_t *b, uint8_t *child, struct mmRng *r)
+{
+    const struct mmCsp *csp = ga->csp;
+    int L = csp->seqlen, cut1 = mmRngBelow(r, L), cut2 = mmRngBelow(r, L), i, j, t;
+
+    if (cut1 > cut2)
+        t = cut1, cut1 = cut2, cut2 = t;
+    for (j = 0; j < L; j++)
+        child[j] = (j >= cut1 && j <= cut2) ? b[j] : a[j];
+
+    switch (mmRngBelow(r, 4))
+    {
+    case 0:
+    { // a new colour at one position, taken from its domain
+        uint8_t fresh[MM_MAX_SEQL];
+        j = mmRngBelow(r, L);
+        gaRandomCode(csp, fresh, r);
+        child[j] = fresh[j];
+        break;
+    }
+    case 1:
+        i = mmRngBelow(r, L);
+        j = mmRngBelow(r, L);
+        t = child[i], child[i] = child[j], child[j] = t;
+        break;
+    case 2:
+        for (i = cut1, j = cut2; i < j; i++, j--)
+            t = child[i], child[i] = child[j], child[j] = t;
+        break;
+    default:
+        break;
+    }
+}
+
+/* colours of a code packed 4 bits each, to tell codes apart */
+static uint64_t gaKey(const uint8_t *code, int L)
+{
+    uint64_t k = 0;
+    for (int j = 0; j < L; j++)
+        k = (k << 4) | code[j];
+    return k;
+}
+
+/* of the @n@ consistent codes in @elig@, the one whose worst answer leaves the fewest of the others */
+static int gaPickEligible(const struct mmConfig *cfg, const uint8_t *elig, int n)
+{
+    int best = 0, bestWorst = n + 1;
+
+    for (int i = 0; i < n; i++)
+    {
+        int counts[MM_MAX_FB], worst = 0;
+        mmHistogram(cfg, MM_HIST_SIMD, elig + (long)i * cfg->seqlen, elig, n, counts);
+        for (int f = 0; f < cfg->nfb; f++)
+            if (counts[f] > worst && f != cfg->winFb)
+                worst = counts[f];
+        if (worst < bestWorst)
+        {
+            bestWorst = worst;
+            best = i;
+        }
+    }
+    return best;
+}
+
+int mmGaGuess(const struct mmConfig *cfg, struct mmPool *pool, const struct mmCsp *csp,
+              const struct mmGaParams *prm, uint8_t *guess, struct mmGaStats *st)
+{
+    static const struct mmGaParams defaults = {150, 100, 60, 0, 1};
+    struct gaState ga;
+    uint64_t start = timeInMicroseconds();
+    struct mmRng r;
+    uint8_t *next, *elig, *tmp;
+    uint64_t *keys;
+    int nelig = 0, maxElig, i, k, fittest = 0, ret = 1;
+    long gen, stall = 0;
+
+    if (st)
+        memset(st, 0, sizeof(*st));
+    // codes cannot even be drawn once a position has no colour left
+    for (i = 0; i < csp->seqlen; i++)
+        if (csp->dom[i] == 0)
+            return -1;
+    if (csp->failed)
+        return -1;
+
+    if (prm == NULL)
+        prm = &defaults;
+    mmRngSeed(&r, prm->seed);
+    memset(&ga, 0, sizeof(ga));
+    ga.cfg = cfg;
+    ga.csp = csp;
+    ga.pop = prm->popSize > 1 ? prm->popSize : 2;
+    maxElig = prm->maxEligible > 0 ? prm->maxEligible : 1;
+    ga.codes = (uint8_t *)malloc((size_t)ga.pop * cfg->seqlen);
+    ga.fitness = (int *)malloc(ga.pop * sizeof(int));
+    ga.scratch = (uint8_t *)malloc((size_t)mmPoolSize(pool) * GA_CHUNK);
+    next = (uint8_t *)malloc((size_t)ga.pop * cfg->seqlen);
+    elig = (uint8_t *)malloc((size_t)maxElig * cfg->seqlen);
+    keys = (uint64_t *)malloc(maxElig * sizeof(uint64_t));
+    if (ga.codes == NULL || ga.fitness == NULL || ga.scratch == NULL || next == NULL || elig == NULL || keys == NULL)
+    {
+        // no memory to evolve anything: a code from the domains will do
+        gaRandomCode(csp, guess, &r);
+        free(keys);
+        free(elig);
+        free(next);
+        free(ga.scratch);
+        free(ga.fitness);
+        free(ga.codes);
+        return -1;
+    }
+
+    for (i = 0; i < ga.pop; i++)
+        gaRandomCode(csp, ga.codes + (long)i * cfg->seqlen, &r);
+
+    for (gen = 0;; gen++)
+    {
+        mmPoolFor(pool, (ga.pop + GA_CHUNK - 1) / GA_CHUNK, gaFitnessTask, &ga);
+
+        // collect new consistent codes, and remember the fittest code
+        fittest = 0;
+        stall++;
+        for (i = 0; i < ga.pop; i++)
+        {
+            const uint8_t *code = ga.codes + (long)i * cfg->seqlen;
+            uint64_t key;
+
+            if (ga.fitness[i] < ga.fitness[fittest])
+                fittest = i;
+            if (ga.fitness[i] != 0 || nelig >= maxElig)
+                continue;
+            key = gaKey(code, cfg->seqlen);
+            for (k = 0; k < nelig && keys[k] != key; k++)
+                ;
+            if (k < nelig)
+                continue;
+            keys[nelig] = key;
+            memcpy(elig + (long)nelig * cfg->seqlen, code, cfg->seqlen);
+            nelig++;
+            stall = 0;
+        }
+
+        if (nelig >= maxElig ||
+            (prm->maxGen && gen + 1 >= prm->maxGen && (nelig > 0 || gen + 1 >= GA_PATIENCE * prm->maxGen)) ||
+            (prm->budget && timeInMicroseconds() - start >= prm->budget) ||
+            stall >= (nelig > 0 ? GA_STALL : GA_PATIENCE * GA_STALL))
+            break;
+
+        // next generation: the fittest code survives, the others are bred
+        memcpy(next, ga.codes + (long)fittest * cfg->seqlen, cfg->seqlen);
+        for (i = 1; i < ga.pop; i++)
+        {
+            int a = gaTournament(&ga, &r), b = gaTournament(&ga, &r);
+            gaBreed(&ga, ga.codes + (long)a * cfg->seqlen, ga.codes + (long)b * cfg->seqlen,
+                    next + (long)i * cfg->seqlen, &r);
+        }
+        tmp = ga.codes, ga.codes = next, next = tmp;
+    }
+
+    if (nelig > 0)
+    {
+        memcpy(guess, elig + (long)gaPickEligible(cfg, elig, nelig) * cfg->seqlen, cfg->seqlen);
+        ret = 0;
+    }
+    else
+        memcpy(guess, ga.codes + (long)fittest * cfg->seqlen, cfg->seqlen);
+
+    if (st)
+    {
+        st->generations = gen + 1;
+        st->evaluated = (gen + 1) * ga.pop;
+        st->eligible = nelig;
+        st->usec = timeInMicroseconds() - start;
+    }
+    free(keys);
+    free(elig);
+    free(next);
+    free(ga.scratch);
+    free(ga.fitness);
+    free(ga.codes);
+    return ret;
+}
@@ -0,0 +1,191 @@
+/*
+ * Partition-histogram kernels: how many codes of an array land in each
+ * feedback class of a guess, scoring and counting in one pass.
+ *
+ * Consecutive codes often land in the same class, so a single histogram
+ * makes each increment wait for the previous store to the same counter.
+ * The fast kernels therefore count into HIST_SUBS sub-histograms, code
+ * i going to lane i % HIST_SUBS, and add them up at the end. The SIMD
+ * kernel compares a whole code against the guess, and against each colour
+ * of the guess, with one vector instruction each; it uses SSE2 on x86, and
+ * NEON on ARM when the compiler targets it (-mfpu=neon on the Raspberry Pi).
+ * On a handful of codes, as in the game's 3x3, setting up the guess and
+ * clearing and adding up the sub-histograms costs more than they save, so
+ * both leave such sets to the scalar kernel.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "mm-solver.h"
+
+// number of sub-histograms
+#define HIST_SUBS 4
+// sets smaller than this are counted by the scalar kernel, whichever is asked for
+#define HIST_SMALL 32
+
+/* the colours of the guess, with their number of occurrences */
+struct histGuess
+{
+    int ncols;
+    uint8_t col[MM_MAX_COLS];
+    int cnt[MM_MAX_COLS];
+};
+
+static void histGuessInit(const struct mmConfig *cfg, const uint8_t *guess, struct histGuess *hg)
+{
+    int gc[MM_MAX_COLS] = {0};
+
+    for (int j = 0; j < cfg->seqlen; j++)
+        gc[guess[j]]++;
+    hg->ncols = 0;
+    for (int c = 0; c < cfg->colors; c++)
+        if (gc[c])
+        {
+            hg->col[hg->ncols] = c;
+            hg->cnt[hg->ncols++] = gc[c];
+        }
+}
+
+/* feedback id of one code; only the colours of the guess can be in common */
+static inline int histScore(const struct mmConfig *cfg, const struct histGuess *hg,
+                            const uint8_t *guess, const uint8_t *code)
+{
+    int cc[MM_MAX_COLS] = {0}, exact = 0, common = 0;
+
+    for (int j = 0; j < cfg->seqlen; j++)
+    {
+        exact += code[j] == guess[j];
+        cc[code[j]]++;
+    }
+    for (int k = 0; k < hg->ncols; k++)
+        common += cc[hg->col[k]] < hg->cnt[k] ? cc[hg->col[k]] : hg->cnt[k];
+    return mmFbId(cfg, exact, common - exact);
+}
+
+/* reference: one code at a time, into one histogram */
+static void histScalar(const struct mmConfig *cfg, const uint8_t *guess, const uint8_t *codes, int n,
+                       int *counts)
+{
+    for (int i = 0; i < n; i++, codes += cfg->seqlen)
+        counts[mmScoreDigits(cfg, guess, codes)]++;
+}
+
+static void histLanes(const struct mmConfig *cfg, const uint8_t *guess, const uint8_t *codes, int n,
+                      int sub[HIST_SUBS][MM_MAX_FB])
+{
+    struct histGuess hg;
+    int L = cfg->seqlen, i = 0;
+
+    histGuessInit(cfg, guess, &hg);
+    for (; i + HIST_SUBS <= n; i += HIST_SUBS)
+        for (int l = 0; l < HIST_SUBS; l++)
+            sub[l][histScore(cfg, &hg, guess, codes + (long)(i + l) * L)]++;
+    for (; i < n; i++)
+        sub[0][histScore(cfg, &hg, guess, codes + (long)i * L)]++;
+}
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+
+#if defined(__SSE2__)
+typedef __m128i histVec;
+#define histLoad(p) _mm_loadu_si128((const __m128i *)(p))
+#define histSplat(c) _mm_set1_epi8((char)(c))
+#define histEqual(a, b, ones) _mm_and_si128(_mm_cmpeq_epi8(a, b), ones)
+#define HIST_SIMD_NAME "sse2"
+
+/* sum of the 16 bytes of @v@ */
+static inline int histSum(__m128i v)
+{
+    __m128i s = _mm_sad_epu8(v, _mm_setzero_si128());
+    return _mm_cvtsi128_si32(s) + _mm_extract_epi16(s, 4);
+}
+#else
+typedef uint8x16_t histVec;
+#define histLoad(p) vld1q_u8(p)
+#define histSplat(c) vdupq_n_u8(c)
+#define histEqual(a, b, ones) vandq_u8(vceqq_u8(a, b), ones)
+#define HIST_SIMD_NAME "neon"
+
+/* sum of the 16 bytes of @v@ */
+static inline int histSum(uint8x16_t v)
+{
+    uint64x2_t s = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(v)));
+    return (int)(vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1));
+}
+#endif
+
+static void histSimd(const struct mmConfig *cfg, const uint8_t *guess, const uint8_t *codes, int n,
+                     int sub[HIST_SUBS][MM_MAX_FB])
+{
+    struct histGuess hg;
+    uint8_t buf[16] = {0};
+    uint8_t first[16] = {0};
+    histVec g, ones, cols[MM_MAX_COLS];
+    int L = cfg->seqlen, i = 0, safe, k;
+
+    // 1 in the lanes of the code, 0 in those of the next one
+    memset(first, 1, L);
+    ones = histLoad(first);
+    histGuessInit(cfg, guess, &hg);
+    memcpy(buf, guess, L);
+    g = histLoad(buf);
+    for (k = 0; k < hg.ncols; k++)
+        cols[k] = histSplat(hg.col[k]);
+
+    // codes whose 16-byte load stays inside the array; the rest are scored one by one
+    safe = (long)n * L >= 16 ? (int)(((long)n * L - 16) / L + 1) : 0;
+    for (; i < safe; i++)
+    {
+        histVec v = histLoad(codes + (long)i * L);
+        int exact = histSum(histEqual(v, g, ones)), common = 0;
+        for (k = 0; k < hg.ncols; k++)
+        {
+            int cnt = histSum(histEqual(v, cols[k], ones));
+            common += cnt < hg.cnt[k] ? cnt : hg.cnt[k];
+        }
+        sub[i % HIST_SUBS][mmFbId(cfg, exact, common - exact)]++;
+    }
+    for (; i < n; i++)
+        sub[0][histScore(cfg, &hg, guess, codes + (long)i * L)]++;
+}
+
+#else
+#define HIST_SIMD_NAME "none"
+#define histSimd histLanes
+#endif
+
+void mmHistogram(const struct mmConfig *cfg, int kernel, const uint8_t *guess, const uint8_t *codes, int n,
+                 int *counts)
+{
+    int sub[HIST_SUBS][MM_MAX_FB];
+
+    memset(counts, 0, cfg->nfb * sizeof(int));
+    if (kernel == MM_HIST_SCALAR || n < HIST_SMALL)
+    {
+        histScalar(cfg, guess, codes, n, counts);
+        return;
+    }
+    for (int l = 0; l < HIST_SUBS; l++)
+        memset(sub[l], 0, cfg->nfb * sizeof(int));
+    if (kernel == MM_HIST_SIMD)
+        histSimd(cfg, guess, codes, n, sub);
+    else
+        histLanes(cfg, guess, codes, n, sub);
+    for (int l = 0; l < HIST_SUBS; l++)
+        for (int f = 0; f < cfg->nfb; f++)
+            counts[f] += sub[l][f];
+}
+
+const char *mmHistogramSimd(void)
+{
+    return HIST_SIMD_NAME;
+}
@@ -0,0 +1,365 @@
+/*
+ * Indexes of the code space, for filtering without rescoring.
+ *
+ * For every (position, colour) there is a bitset of the codes with that
+ * colour at that position, and for every (colour, k) one of the codes with
+ * at least k of that colour. Against a guess g, the exact matches of a code
+ * are the number of bitsets (j, g[j]) it is in, and its colours in common
+ * are the number of bitsets (c, k) it is in, for k up to the count of c in
+ * g. Both are counted 64 codes at a time by bit-sliced adders, so the codes
+ * consistent with an answer come out of a few logic operations per word.
+ * On code spaces without a feedback table, mmFilter() goes through the
+ * index of its configuration on sets of most of the code space, and through
+ * its multiset groups on sets of at least a code per group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm-solver.h"
+
+// bit planes of the counters, enough for counts up to MM_MAX_SEQL
+#define IX_PLANES 5
+
+/* ======================================================= */
+/* SECTION: positional colour bitsets                      */
+/* ------------------------------------------------------- */
+
+int mmIndexInit(const struct mmConfig *cfg, struct mmIndex *ix)
+{
+    int L = cfg->seqlen, c, j, k;
+
+    memset(ix, 0, sizeof(*ix));
+    if (cfg->ncodes == 0)
+        return -1;
+    ix->cfg = cfg;
+    ix->words = (cfg->ncodes + 63) / 64;
+    // (position, colour) bitsets first, then (colour, at least k + 1)
+    ix->nsets = 2 * L * cfg->colors;
+    ix->bits = (uint64_t *)calloc((size_t)ix->words * ix->nsets, sizeof(uint64_t));
+    if (ix->bits == NULL)
+        return -1;
+
+    for (c = 0; c < cfg->ncodes; c++)
+    {
+        const uint8_t *d = cfg->digits + (long)c * L;
+        uint64_t *w = ix->bits + (long)(c / 64) * ix->nsets, bit = 1ULL << (c % 64);
+        int cnt[MM_MAX_COLS] = {0};
+
+        for (j = 0; j < L; j++)
+        {
+            w[j * cfg->colors + d[j]] |= bit;
+            cnt[d[j]]++;
+        }
+        for (k = 0; k < cfg->colors; k++)
+            for (j = 0; j < cnt[k]; j++)
+                w[L * cfg->colors + k * L + j] |= bit;
+    }
+    return 0;
+}
+
+void mmIndexFree(struct mmIndex *ix)
+{
+    free(ix->bits);
+    memset(ix, 0, sizeof(*ix));
+}
+
+size_t mmIndexBytes(const struct mmIndex *ix)
+{
+    return (size_t)ix->words * ix->nsets * sizeof(uint64_t);
+}
+
+// the bitsets to count against one guess
+struct ixGuess
+{
+    int L;
+    int exactSets[MM_MAX_SEQL], commonSets[MM_MAX_SEQL];
+    int exact, common; // the counts a code must have
+};
+
+static void ixGuessInit(const struct mmIndex *ix, int guess, int fb, struct ixGuess *ig)
+{
+    const struct mmConfig *cfg = ix->cfg;
+    const uint8_t *g = cfg->digits + (long)guess * cfg->seqlen;
+    int L = cfg->seqlen, gc[MM_MAX_COLS] = {0}, c, j, k = 0;
+
+    ig->L = L;
+    for (j = 0; j < L; j++)
+    {
+        ig->exactSets[j] = j * cfg->colors + g[j];
+        gc[g[j]]++;
+    }
+    // sum over colours of min(count in code, count in guess)
+    for (c = 0; c < cfg->colors; c++)
+        for (j = 0; j < gc[c]; j++)
+            ig->commonSets[k++] = L * cfg->colors + c * L + j;
+    ig->exact = mmFbExact(cfg, fb);
+    ig->common = ig->exact + mmFbApprox(cfg, fb);
+}
+
+/* add the one-bit numbers of @x@ to the bit-sliced counters @p@ */
+static inline void ixAdd(uint64_t *p, uint64_t x)
+{
+    for (int b = 0; b < IX_PLANES && x; b++)
+    {
+        uint64_t carry = p[b] & x;
+        p[b] ^= x;
+        x = carry;
+    }
+}
+
+/* the counters of @p@ that are equal to @v@ */
+static inline uint64_t ixEqual(const uint64_t *p, int v)
+{
+    uint64_t m = ~0ULL;
+    for (int b = 0; b < IX_PLANES; b++)
+        m &= (v >> b) & 1 ? p[b] : ~p[b];
+    return m;
+}
+
+/* the codes of word @w@ that answer the feedback of @ig@ */
+static uint64_t ixMask(const struct mmIndex *ix, const struct ixGuess *ig, int w)
+{
+    const uint64_t *bits = ix->bits + (long)w * ix->nsets;
+    uint64_t e[IX_PLANES] = {0}, c[IX_PLANES] = {0};
+
+    for (int j = 0; j < ig->L; j++)
+    {
+        ixAdd(e, bits[ig->exactSets[j]]);
+        ixAdd(c, bits[ig->commonSets[j]]);
+    }
+    return ixEqual(e, ig->exact) & ixEqual(c, ig->common);
+}
+
+int mmIndexFilter(const struct mmIndex *ix, uint64_t *cand, int guess, int fb)
+{
+    struct ixGuess ig;
+    int n = 0;
+
+    ixGuessInit(ix, guess, fb, &ig);
+    for (int w = 0; w < ix->words; w++)
+    {
+        if (cand[w] == 0)
+            continue;
+        cand[w] &= ixMask(ix, &ig, w);
+        n += __builtin_popcountll(cand[w]);
+    }
+    return n;
+}
+
+/* each word of the code space is evaluated once, for the first member of @set@ in it */
+int mmIndexFilterSet(const struct mmIndex *ix, int *set, int n, int guess, int fb)
+{
+    struct ixGuess ig;
+    uint64_t mask = 0;
+    int k = 0, w = -1;
+
+    ixGuessInit(ix, guess, fb, &ig);
+    for (int i = 0; i < n; i++)
+    {
+        if (set[i] / 64 != w)
+        {
+            w = set[i] / 64;
+            mask = ixMask(ix, &ig, w);
+        }
+        if (mask & (1ULL << (set[i] % 64)))
+            set[k++] = set[i];
+    }
+    return k;
+}
+
+void mmIndexAll(const struct mmIndex *ix, uint64_t *cand)
+{
+    memset(cand, 0xff, ix->words * sizeof(uint64_t));
+    if (ix->cfg->ncodes % 64)
+        cand[ix->words - 1] = (1ULL << (ix->cfg->ncodes % 64)) - 1;
+}
+
+int mmIndexAttach(struct mmConfig *cfg)
+{
+    struct mmIndex *ix;
+    struct mmMultiset *ms;
+
+    // with a feedback table, rescoring is a lookup, which no index beats; the index
+    // takes seqlen * colors / 4 bytes per code, the multiset groups 8
+    if (cfg->ncodes == 0 || cfg->fbTable || (size_t)cfg->ncodes * cfg->seqlen * cfg->colors / 4 > MM_MAX_INDEX)
+        return -1;
+    ix = (struct mmIndex *)malloc(sizeof(*ix));
+    ms = (struct mmMultiset *)malloc(sizeof(*ms));
+    if (ix == NULL || ms == NULL || mmIndexInit(cfg, ix) != 0)
+    {
+        free(ms);
+        free(ix);
+        return -1;
+    }
+    if (mmMultisetInit(cfg, ms) != 0)
+    {
+        mmIndexFree(ix);
+        free(ms);
+        free(ix);
+        return -1;
+    }
+    cfg->index = ix;
+    cfg->multiset = ms;
+    return 0;
+}
+
+void mmIndexDetach(struct mmConfig *cfg)
+{
+    if (cfg->index)
+    {
+        mmIndexFree(cfg->index);
+        free(cfg->index);
+        cfg->index = NULL;
+    }
+    if (cfg->multiset)
+    {
+        mmMultisetFree(cfg->multiset);
+        free(cfg->multiset);
+        cfg->multiset = NULL;
+    }
+}
+
+/* ======================================================= */
+/* SECTION: colour-multiset groups                         */
+/* ------------------------------------------------------- */
+
+/*
+ * The number of colours two codes have in common only depends on their
+ * colour multisets. So the codes are grouped by multiset, the colours in
+ * common with the guess are counted once per group, and only the codes of
+ * the groups that agree with the answer have their exact matches checked.
+ */
+
+/* hash slot of the colour counts @key@ in a table of @size@ slots */
+static int msSlot(const uint64_t *keys, const int *gid, int size, uint64_t key)
+{
+    int i = (int)((key * 0x9e3779b97f4a7c15ULL) >> 40) & (size - 1);
+    while (gid[i] >= 0 && keys[i] != key)
+        i = (i + 1) & (size - 1);
+    return i;
+}
+
+int mmMultisetInit(const struct mmConfig *cfg, struct mmMultiset *ms)
+{
+    int L = cfg->seqlen, size = 1, c, j, g, *gid, *pos = NULL;
+    uint64_t *keys, most = 1;
+
+    memset(ms, 0, sizeof(*ms));
+    if (cfg->ncodes == 0)
+        return -1;
+    ms->cfg = cfg;
+
+    // there are C(seqlen + colors - 1, seqlen) multisets
+    for (j = 1; j <= L; j++)
+        most = most * (cfg->colors - 1 + j) / j;
+    while (size < 2 * (int)most)
+        size *= 2;
+    keys = (uint64_t *)malloc(size * sizeof(uint64_t));
+    gid = (int *)malloc(size * sizeof(int));
+    ms->group = (int *)malloc(cfg->ncodes * sizeof(int));
+    ms->members = (int *)malloc(cfg->ncodes * sizeof(int));
+    ms->start = (int *)calloc(most + 1, sizeof(int));
+    ms->counts = (uint8_t *)malloc((size_t)most * cfg->colors);
+    if (keys == NULL || gid == NULL || ms->group == NULL || ms->members == NULL || ms->start == NULL ||
+        ms->counts == NULL)
+    {
+        free(gid);
+        free(keys);
+        mmMultisetFree(ms);
+        return -1;
+    }
+    memset(gid, -1, size * sizeof(int));
+
+    // group ids in order of first appearance, the colour counts of a code as a number in base seqlen+1
+    for (c = 0; c < cfg->ncodes; c++)
+    {
+        const uint8_t *d = cfg->digits + (long)c * L;
+        uint8_t cnt[MM_MAX_COLS] = {0};
+        uint64_t key = 0;
+
+        for (j = 0; j < L; j++)
+            cnt[d[j]]++;
+        for (j = 0; j < cfg->colors; j++)
+            key = key * (L + 1) + cnt[j];
+        j = msSlot(keys, gid, size, key);
+        if (gid[j] < 0)
+        {
+            keys[j] = key;
+            gid[j] = ms->ngroups++;
+            memcpy(ms->counts + (long)gid[j] * cfg->colors, cnt, cfg->colors);
+        }
+        ms->group[c] = gid[j];
+        ms->start[gid[j] + 1]++;
+    }
+    free(gid);
+    free(keys);
+
+    // members by group, keeping the codes in order
+    for (g = 0; g < ms->ngroups; g++)
+        ms->start[g + 1] += ms->start[g];
+    if ((pos = (int *)malloc(ms->ngroups * sizeof(int))) == NULL)
+    {
+        mmMultisetFree(ms);
+        return -1;
+    }
+    memcpy(pos, ms->start, ms->ngroups * sizeof(int));
+    for (c = 0; c < cfg->ncodes; c++)
+        ms->members[pos[ms->group[c]]++] = c;
+    free(pos);
+    return 0;
+}
+
+void mmMultisetFree(struct mmMultiset *ms)
+{
+    free(ms->group);
+    free(ms->members);
+    free(ms->start);
+    free(ms->counts);
+    memset(ms, 0, sizeof(*ms));
+}
+
+/* which groups have @common@ colours in common with @guess@; @ok@ has ngroups bytes */
+static void msGroupsAgreeing(const struct mmMultiset *ms, const uint8_t *guess, int common, uint8_t *ok)
+{
+    const struct mmConfig *cfg = ms->cfg;
+    int gc[MM_MAX_COLS] = {0}, g, c;
+
+    for (c = 0; c < cfg->seqlen; c++)
+        gc[guess[c]]++;
+    for (g = 0; g < ms->ngroups; g++)
+    {
+        const uint8_t *cnt = ms->counts + (long)g * cfg->colors;
+        int k = 0;
+        for (c = 0; c < cfg->colors; c++)
+            k += cnt[c] < gc[c] ? cnt[c] : gc[c];
+        ok[g] = k == common;
+    }
+}
+
+static int msExact(const struct mmConfig *cfg, const uint8_t *a, const uint8_t *b)
+{
+    int exact = 0;
+    for (int j = 0; j < cfg->seqlen; j++)
+        exact += a[j] == b[j];
+    return exact;
+}
+
+int mmMultisetFilter(const struct mmMultiset *ms, int *set, int n, int guess, int fb)
+{
+    const struct mmConfig *cfg = ms->cfg;
+    const uint8_t *g = cfg->digits + (long)guess * cfg->seqlen;
+    uint8_t *ok = (uint8_t *)malloc(ms->ngroups);
+    int exact = mmFbExact(cfg, fb), k = 0;
+
+    if (ok == NULL)
+        return -1;
+    msGroupsAgreeing(ms, g, exact + mmFbApprox(cfg, fb), ok);
+    for (int i = 0; i < n; i++)
+        if (ok[ms->group[set[i]]] && msExact(cfg, g, cfg->digits + (long)set[i] * cfg->seqlen) == exact)
+            set[k++] = set[i];
+    free(ok);
+    return k;
+}
@@ -0,0 +1,220 @@
+/*
+ * Game event log: one fixed-size record per answered guess, appended to a
+ * file that is allocated in full when it is made and mapped with mmap, so
+ * logging an event is a few stores and no system call.
+ *
+ * A writer reserves the next record with an atomic increment of the count
+ * in the header, fills it, and sets its type last; a reader takes records
+ * of type 0 as still being written. As the header and records live in a
+ * shared mapping, several threads, or processes, may append to one log at
+ * once. Once the log is full, further records are counted and dropped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mm-solver.h"
+
+#define LOG_MAGIC 0x31474f4c4d4d4d00ULL // "\0MMMLOG1"
+#define LOG_VERSION 1
+
+struct logHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    int32_t colors, seqlen;
+    uint64_t capacity;
+    uint64_t next;    // records reserved; past the capacity, they were dropped
+    uint64_t dropped;
+    uint32_t games;   // game numbers handed out
+    uint8_t pad[12];
+};
+
+struct mmLog
+{
+    struct logHeader *hdr;
+    struct mmLogRecord *records; // inside the mapping, after the header
+    void *map;
+    size_t mapBytes;
+    int fd;
+};
+
+/* ======================================================= */
+/* SECTION: writing                                        */
+/* ------------------------------------------------------- */
+
+/* check the header of a mapped log of @bytes@ bytes */
+static int logValid(const struct logHeader *hdr, size_t bytes)
+{
+    return hdr->magic == LOG_MAGIC && hdr->version == LOG_VERSION && hdr->recordSize == sizeof(struct mmLogRecord) &&
+           hdr->capacity <= (bytes - sizeof(struct logHeader)) / sizeof(struct mmLogRecord);
+}
+
+struct mmLog *mmLogOpen(const char *path, const struct mmConfig *cfg, long capacity)
+{
+    struct mmLog *log = (struct mmLog *)calloc(1, sizeof(struct mmLog));
+    struct stat sb;
+    int fresh;
+
+    if (log == NULL)
+        return NULL;
+    if (capacity <= 0)
+        capacity = MM_LOG_CAPACITY;
+    log->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (log->fd < 0 || fstat(log->fd, &sb) != 0)
+    {
+        mmLogClose(log);
+        return NULL;
+    }
+
+    // a new log is allocated in full, so that no store to the mapping can fail for want of space
+    fresh = sb.st_size == 0;
+    log->mapBytes = fresh ? sizeof(struct logHeader) + (size_t)capacity * sizeof(struct mmLogRecord) : (size_t)sb.st_size;
+    if (log->mapBytes < sizeof(struct logHeader) || (fresh && posix_fallocate(log->fd, 0, log->mapBytes) != 0))
+    {
+        mmLogClose(log);
+        return NULL;
+    }
+    log->map = mmap(NULL, log->mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd, 0);
+    if (log->map == MAP_FAILED)
+    {
+        log->map = NULL;
+        mmLogClose(log);
+        return NULL;
+    }
+    log->hdr = (struct logHeader *)log->map;
+    log->records = (struct mmLogRecord *)(log->hdr + 1);
+
+    if (fresh)
+    {
+        log->hdr->version = LOG_VERSION;
+        log->hdr->recordSize = sizeof(struct mmLogRecord);
+        log->hdr->colors = cfg->colors;
+        log->hdr->seqlen = cfg->seqlen;
+        log->hdr->capacity = capacity;
+        __sync_synchronize();
+        log->hdr->magic = LOG_MAGIC;
+    }
+    // unlike a memo store, a log of another configuration is kept, not reused
+    else if (!logValid(log->hdr, log->mapBytes) || log->hdr->colors != cfg->colors || log->hdr->seqlen != cfg->seqlen)
+    {
+        mmLogClose(log);
+        return NULL;
+    }
+    return log;
+}
+
+uint32_t mmLogGame(struct mmLog *log)
+{
+    return __sync_fetch_and_add(&log->hdr->games, 1);
+}
+
+int mmLogAppend(struct mmLog *log, const struct mmLogRecord *r)
+{
+    uint64_t i = __sync_fetch_and_add(&log->hdr->next, 1);
+    struct mmLogRecord *slot;
+
+    if (i >= log->hdr->capacity)
+    {
+        __sync_fetch_and_add(&log->hdr->dropped, 1);
+        return -1;
+    }
+    slot = &log->records[i];
+    memcpy(slot, r, sizeof(*r));
+    slot->type = 0;
+    // the record is complete before its type says so
+    __atomic_store_n(&slot->type, r->type, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void mmLogClose(struct mmLog *log)
+{
+    if (log->map)
+        munmap(log->map, log->mapBytes);
+    if (log->fd >= 0)
+        close(log->fd);
+    free(log);
+}
+
+/* ======================================================= */
+/* SECTION: reading                                        */
+/* ------------------------------------------------------- */
+
+int mmLogMap(struct mmLogView *v, int fd)
+{
+    const struct logHeader *hdr;
+    struct stat sb;
+
+    memset(v, 0, sizeof(*v));
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(struct logHeader))
+        return -1;
+    v->mapBytes = sb.st_size;
+    v->map = mmap(NULL, v->mapBytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (v->map == MAP_FAILED)
+    {
+        v->map = NULL;
+        return -1;
+    }
+    hdr = (const struct logHeader *)v->map;
+    if (!logValid(hdr, v->mapBytes))
+    {
+        mmLogUnmap(v);
+        return -1;
+    }
+    v->colors = hdr->colors;
+    v->seqlen = hdr->seqlen;
+    v->capacity = hdr->capacity;
+    v->count = hdr->next < hdr->capacity ? hdr->next : hdr->capacity;
+    v->dropped = hdr->dropped;
+    v->records = (const struct mmLogRecord *)(hdr + 1);
+    // the records are read once, from the first to the last
+    madvise(v->map, v->mapBytes, MADV_SEQUENTIAL);
+    return 0;
+}
+
+void mmLogUnmap(struct mmLogView *v)
+{
+    if (v->map)
+        munmap(v->map, v->mapBytes);
+    memset(v, 0, sizeof(*v));
+}
+
+void mmLogScan(const struct mmLogView *v, struct mmLogStats *st)
+{
+    memset(st, 0, sizeof(*st));
+    for (long i = 0; i < v->count; i++)
+    {
+        const struct mmLogRecord *r = &v->records[i];
+
+        if (__atomic_load_n(&r->type, __ATOMIC_ACQUIRE) == 0)
+        {
+            st->unfinished++;
+            continue;
+        }
+        st->records++;
+        st->thinkUsec += r->thinkUsec;
+        st->answerUsec += r->answerUsec;
+        if (r->answerUsec > st->maxAnswerUsec)
+            st->maxAnswerUsec = r->answerUsec;
+        if (st->firstUsec == 0 || r->usec < st->firstUsec)
+            st->firstUsec = r->usec;
+        if (r->usec > st->lastUsec)
+            st->lastUsec = r->usec;
+        if (r->type == MM_LOG_WON)
+        {
+            st->won++;
+            st->attempts[r->attempt < MM_LOG_ATTEMPTS ? r->attempt : MM_LOG_ATTEMPTS]++;
+        }
+        else if (r->type == MM_LOG_LOST)
+            st->lost++;
+    }
+    st->games = st->won + st->lost;
+}
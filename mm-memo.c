@@ -0,0 +1,319 @@
+/*
+ * Memo store for the solvers: values of candidate subsets, keyed by a
+ * 128-bit Zobrist fingerprint of the subset (the XOR of a fixed random
+ * value per member code), so a subset is neither hashed again nor stored.
+ *
+ * The store has two tiers of buckets. The memory tier holds the entries
+ * of the larger subsets, which took the most work to solve; when one of
+ * its buckets is full, the entry of the smallest subset spills to the disk
+ * tier, a file mapped with mmap. All memory entries are written to the
+ * file when the store is closed, and the file is reused by the next run on
+ * the same configuration and objective.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mm-solver.h"
+
+// buckets of each tier, and entries per bucket
+#define MEMO_MEM_BUCKETS (1 << 16)
+#define MEMO_MEM_WAYS 4
+#define MEMO_DISK_BUCKETS (1 << 17)
+#define MEMO_DISK_WAYS 8
+// lock stripes of each tier
+#define MEMO_STRIPES 64
+
+#define MEMO_MAGIC 0x314f4d454d4d4d00ULL // "\0MMMEMO1"
+
+struct memoEntry
+{
+    uint64_t lo, hi; // fingerprint; 0 if the entry is free
+    int32_t n;       // size of the subset
+    int32_t value;   // exact value if @exact@, otherwise a lower bound
+    int32_t guess;
+    int32_t exact;
+};
+
+struct memoHeader
+{
+    uint64_t magic;
+    int32_t colors, seqlen, objective, buckets;
+    uint8_t pad[40];
+};
+
+struct mmMemo
+{
+    struct memoEntry *mem;
+    struct memoEntry *disk; // inside the mapping, after the header
+    void *map;
+    size_t mapBytes;
+    int fd;
+    long loaded, spilled;
+    pthread_mutex_t memLocks[MEMO_STRIPES], diskLocks[MEMO_STRIPES];
+};
+
+/* ======================================================= */
+/* SECTION: fingerprints                                   */
+/* ------------------------------------------------------- */
+
+struct mmFp mmFpSet(const int *set, int n)
+{
+    struct mmFp fp = {0, 0};
+    for (int i = 0; i < n; i++)
+        mmFpXor(&fp, mmFpCode(set[i]));
+    return fp;
+}
+
+/* ======================================================= */
+/* SECTION: two-tier store                                 */
+/* ------------------------------------------------------- */
+
+struct mmMemo *mmMemoOpen(const char *path, const struct mmConfig *cfg, int objective)
+{
+    struct mmMemo *memo = (struct mmMemo *)calloc(1, sizeof(struct mmMemo));
+    struct memoHeader *hdr;
+    struct stat sb;
+    long i;
+
+    if (memo == NULL)
+        return NULL;
+    memo->fd = -1;
+    memo->mem = (struct memoEntry *)calloc((size_t)MEMO_MEM_BUCKETS * MEMO_MEM_WAYS, sizeof(struct memoEntry));
+    if (memo->mem == NULL)
+    {
+        free(memo);
+        return NULL;
+    }
+    for (i = 0; i < MEMO_STRIPES; i++)
+    {
+        pthread_mutex_init(&memo->memLocks[i], NULL);
+        pthread_mutex_init(&memo->diskLocks[i], NULL);
+    }
+    if (path == NULL)
+        return memo;
+
+    memo->mapBytes = sizeof(struct memoHeader) + (size_t)MEMO_DISK_BUCKETS * MEMO_DISK_WAYS * sizeof(struct memoEntry);
+    memo->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (memo->fd < 0 || fstat(memo->fd, &sb) != 0 ||
+        ((size_t)sb.st_size != memo->mapBytes && ftruncate(memo->fd, memo->mapBytes) != 0))
+    {
+        mmMemoClose(memo);
+        return NULL;
+    }
+    memo->map = mmap(NULL, memo->mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, memo->fd, 0);
+    if (memo->map == MAP_FAILED)
+    {
+        memo->map = NULL;
+        mmMemoClose(memo);
+        return NULL;
+    }
+    hdr = (struct memoHeader *)memo->map;
+    memo->disk = (struct memoEntry *)(hdr + 1);
+
+    // the values of another configuration or objective are of no use
+    if (hdr->magic != MEMO_MAGIC || hdr->colors != cfg->colors || hdr->seqlen != cfg->seqlen ||
+        hdr->objective != objective || hdr->buckets != MEMO_DISK_BUCKETS)
+    {
+        memset(memo->map, 0, memo->mapBytes);
+        hdr->magic = MEMO_MAGIC;
+        hdr->colors = cfg->colors;
+        hdr->seqlen = cfg->seqlen;
+        hdr->objective = objective;
+        hdr->buckets = MEMO_DISK_BUCKETS;
+    }
+    else
+        for (i = 0; i < (long)MEMO_DISK_BUCKETS * MEMO_DISK_WAYS; i++)
+            if (memo->disk[i].lo || memo->disk[i].hi)
+                memo->loaded++;
+    return memo;
+}
+
+static int memoSame(const struct memoEntry *e, struct mmFp fp)
+{
+    return e->lo == fp.lo && e->hi == fp.hi;
+}
+
+static int memoFree(const struct memoEntry *e)
+{
+    return e->lo == 0 && e->hi == 0;
+}
+
+/* merge a new result into @e@: never replace an exact value, and only raise lower bounds */
+static void memoMerge(struct memoEntry *e, int value, int exact, int guess)
+{
+    if (!e->exact && (exact || value > e->value))
+    {
+        e->value = value;
+        e->exact = exact;
+        e->guess = guess;
+    }
+}
+
+/* the entry of @fp@ in @bucket@, a free one, or NULL */
+static struct memoEntry *memoSlot(struct memoEntry *bucket, int ways, struct mmFp fp)
+{
+    struct memoEntry *empty = NULL;
+    for (int w = 0; w < ways; w++)
+    {
+        if (memoSame(&bucket[w], fp))
+            return &bucket[w];
+        if (empty == NULL && memoFree(&bucket[w]))
+            empty = &bucket[w];
+    }
+    return empty;
+}
+
+/* put a result into the disk tier; dropped if the bucket is full of larger subsets */
+static void memoPutDisk(struct mmMemo *memo, const struct memoEntry *in)
+{
+    struct mmFp fp = {in->lo, in->hi};
+    long b = (long)((in->hi >> 17) & (MEMO_DISK_BUCKETS - 1));
+    struct memoEntry *bucket = memo->disk + b * MEMO_DISK_WAYS, *e;
+
+    pthread_mutex_lock(&memo->diskLocks[b & (MEMO_STRIPES - 1)]);
+    e = memoSlot(bucket, MEMO_DISK_WAYS, fp);
+    if (e == NULL)
+    {
+        e = &bucket[0];
+        for (int w = 1; w < MEMO_DISK_WAYS; w++)
+            if (bucket[w].n < e->n)
+                e = &bucket[w];
+        if (e->n > in->n)
+            e = NULL;
+        else
+            memset(e, 0, sizeof(*e));
+    }
+    if (e && memoFree(e))
+        *e = *in;
+    else if (e)
+        memoMerge(e, in->value, in->exact, in->guess);
+    pthread_mutex_unlock(&memo->diskLocks[b & (MEMO_STRIPES - 1)]);
+}
+
+int mmMemoGet(struct mmMemo *memo, struct mmFp fp, int *value, int *exact, int *guess)
+{
+    long b = (long)(fp.lo & (MEMO_MEM_BUCKETS - 1));
+    struct memoEntry *e, found;
+    int hit = 0;
+
+    memset(&found, 0, sizeof(found));
+
+    pthread_mutex_lock(&memo->memLocks[b & (MEMO_STRIPES - 1)]);
+    e = memoSlot(memo->mem + b * MEMO_MEM_WAYS, MEMO_MEM_WAYS, fp);
+    if (e && !memoFree(e))
+    {
+        found = *e;
+        hit = 1;
+    }
+    pthread_mutex_unlock(&memo->memLocks[b & (MEMO_STRIPES - 1)]);
+
+    // the disk tier may know more than a lower bound
+    if (memo->disk && !(hit && found.exact))
+    {
+        b = (long)((fp.hi >> 17) & (MEMO_DISK_BUCKETS - 1));
+        pthread_mutex_lock(&memo->diskLocks[b & (MEMO_STRIPES - 1)]);
+        e = memoSlot(memo->disk + b * MEMO_DISK_WAYS, MEMO_DISK_WAYS, fp);
+        if (e && !memoFree(e))
+        {
+            if (!hit)
+            {
+                found = *e;
+                hit = 1;
+            }
+            else
+                memoMerge(&found, e->value, e->exact, e->guess);
+        }
+        pthread_mutex_unlock(&memo->diskLocks[b & (MEMO_STRIPES - 1)]);
+    }
+
+    if (hit)
+    {
+        *value = found.value;
+        *exact = found.exact;
+        *guess = found.guess;
+    }
+    return hit;
+}
+
+void mmMemoPut(struct mmMemo *memo, struct mmFp fp, int n, int value, int exact, int guess)
+{
+    long b = (long)(fp.lo & (MEMO_MEM_BUCKETS - 1));
+    struct memoEntry *bucket = memo->mem + b * MEMO_MEM_WAYS, *e, in, out;
+    int spill = 0;
+
+    in.lo = fp.lo;
+    in.hi = fp.hi;
+    in.n = n;
+    in.value = value;
+    in.exact = exact;
+    in.guess = guess;
+
+    pthread_mutex_lock(&memo->memLocks[b & (MEMO_STRIPES - 1)]);
+    e = memoSlot(bucket, MEMO_MEM_WAYS, fp);
+    if (e && !memoFree(e))
+        memoMerge(e, value, exact, guess);
+    else if (e)
+        *e = in;
+    else
+    {
+        // full: the smallest subset goes to disk
+        e = &bucket[0];
+        for (int w = 1; w < MEMO_MEM_WAYS; w++)
+            if (bucket[w].n < e->n)
+                e = &bucket[w];
+        if (e->n < n)
+        {
+            out = *e;
+            *e = in;
+        }
+        else
+            out = in;
+        spill = 1;
+    }
+    pthread_mutex_unlock(&memo->memLocks[b & (MEMO_STRIPES - 1)]);
+
+    if (spill && memo->disk)
+    {
+        __sync_fetch_and_add(&memo->spilled, 1);
+        memoPutDisk(memo, &out);
+    }
+}
+
+void mmMemoStats(const struct mmMemo *memo, struct mmMemoStats *st)
+{
+    st->loaded = memo->loaded;
+    st->spilled = memo->spilled;
+}
+
+void mmMemoClose(struct mmMemo *memo)
+{
+    if (memo == NULL)
+        return;
+    if (memo->disk)
+    {
+        for (long i = 0; i < (long)MEMO_MEM_BUCKETS * MEMO_MEM_WAYS; i++)
+            if (!memoFree(&memo->mem[i]))
+                memoPutDisk(memo, &memo->mem[i]);
+        msync(memo->map, memo->mapBytes, MS_SYNC);
+    }
+    if (memo->map)
+        munmap(memo->map, memo->mapBytes);
+    if (memo->fd >= 0)
+        close(memo->fd);
+    for (int i = 0; i < MEMO_STRIPES; i++)
+    {
+        pthread_mutex_destroy(&memo->memLocks[i]);
+        pthread_mutex_destroy(&memo->diskLocks[i]);
+    }
+    free(memo->mem);
+    free(memo);
+}
@@ -0,0 +1,527 @@
+/*
+ * Exact optimal strategy for a configuration, as a decision tree.
+ *
+ * The search is a depth-first branch-and-bound over candidate subsets:
+ * the value of a subset is the best, over all guesses, of the guess itself
+ * plus the values of the subsets it splits into. Before a guess is
+ * explored, its partition counts give a lower bound (a class of k codes
+ * can have one code found by the next guess, a handful by the guess after
+ * that, and so on), so most guesses are cut off without recursion. Solved subsets are kept
+ * in a memo store (see mm-memo.c), since different histories often lead to the same set;
+ * their fingerprints are computed for all classes of a split in the same pass.
+ * Only one guess of each class of symmetric guesses is tried (see
+ * mm-symmetry.c). The guesses at the root are spread over the work pool.
+ * Each subset is split into its classes in one pass (mmPartition), into
+ * memory taken from a per-thread stack, so the recursion walks contiguous
+ * arrays and allocates nothing per node.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+#include <pthread.h>
+
+#include "mm-solver.h"
+
+// subsets smaller than this are cheap enough to be searched again
+#define MEMO_MIN 3
+
+// scratch stack of each thread, in levels of recursion over the whole code space
+#define STACK_LEVELS 12
+
+/* ======================================================= */
+/* SECTION: scratch stack                                  */
+/* ------------------------------------------------------- */
+
+struct treeStack
+{
+    char *base;
+    size_t top, cap;
+};
+
+/* @bytes@ of scratch memory, to be given back with stackPop in reverse order;
+   taken from the heap once the stack is full */
+static void *stackPush(struct treeStack *stk, size_t bytes)
+{
+    void *p;
+
+    bytes = (bytes + 15) & ~(size_t)15;
+    if (stk->top + bytes > stk->cap)
+        return malloc(bytes);
+    p = stk->base + stk->top;
+    stk->top += bytes;
+    return p;
+}
+
+static void stackPop(struct treeStack *stk, void *p)
+{
+    if ((char *)p >= stk->base && (char *)p < stk->base + stk->cap)
+        stk->top = (char *)p - stk->base;
+    else
+        free(p);
+}
+
+/* ======================================================= */
+/* SECTION: branch-and-bound search                        */
+/* ------------------------------------------------------- */
+
+struct treeSolver
+{
+    const struct mmConfig *cfg;
+    int objective;
+    int branch; // most answers, other than a win, that a guess can get
+    struct mmMemo *memo;
+    struct mmFp *codeFp;      // fingerprint of each code
+    struct treeStack *stacks; // one per worker of the pool
+    long nodes, memoHits, pruned;
+    // shared state of the parallel root search
+    const int *root;
+    int nroot;
+    struct mmSymmetry rootSym;
+    struct candidate *rootCand;
+    int rootBest, rootGuess;
+    pthread_mutex_t rootLock;
+};
+
+struct candidate
+{
+    int guess;
+    int bound; // lower bound on the value of the subset when playing @guess@
+    int inSet;
+};
+
+/* lower bound on the value of a class of @k@ codes: one code can be found by
+   the next guess, at most @branch@ by the one after, @branch@^2 after that... */
+static int classBound(const struct treeSolver *sv, int k)
+{
+    long level = 1, left = k, total = 0;
+    int depth = 0;
+
+    while (left > 0)
+    {
+        long here = left < level ? left : level;
+        depth++;
+        total += here * depth;
+        left -= here;
+        level *= sv->branch;
+    }
+    return sv->objective == MM_WORST ? depth : (int)total;
+}
+
+/* lower bound of playing a guess with partition @counts@ on a set of @n@ codes */
+static int guessBound(const struct treeSolver *sv, const int *counts, int n)
+{
+    int f, b = 0;
+    for (f = 0; f < sv->cfg->nfb; f++)
+    {
+        if (f == sv->cfg->winFb || counts[f] == 0)
+            continue;
+        if (sv->objective == MM_WORST)
+        {
+            if (classBound(sv, counts[f]) > b)
+                b = classBound(sv, counts[f]);
+        }
+        else
+            b += classBound(sv, counts[f]);
+    }
+    return sv->objective == MM_WORST ? 1 + b : n + b;
+}
+
+static int candCompare(const void *pa, const void *pb)
+{
+    const struct candidate *a = (const struct candidate *)pa, *b = (const struct candidate *)pb;
+    if (a->bound != b->bound)
+        return a->bound - b->bound;
+    if (a->inSet != b->inSet)
+        return b->inSet - a->inSet;
+    return a->guess - b->guess;
+}
+
+/* the two guesses split @set@ in the same way */
+static int samePartition(const struct mmConfig *cfg, int g1, int g2, const int *set, int n)
+{
+    for (int i = 0; i < n; i++)
+        if (mmFeedback(cfg, g1, set[i]) != mmFeedback(cfg, g2, set[i]))
+            return 0;
+    return 1;
+}
+
+/* all guesses that tell something about @set@, ordered by their lower bound; only one
+   guess is kept of each class of symmetric guesses, and of guesses that split the set
+   in the same way */
+static int listCandidates(const struct treeSolver *sv, struct treeStack *stk, const int *set, int n,
+                          const struct mmSymmetry *sym, struct candidate *cand)
+{
+    const struct mmConfig *cfg = sv->cfg;
+    int counts[MM_MAX_FB], k = 0, size = 1, f, i, r, nreps;
+    uint64_t *sigs;
+    int *owner, *reps;
+
+    while (size < 2 * cfg->ncodes)
+        size *= 2;
+    sigs = (uint64_t *)stackPush(stk, size * sizeof(uint64_t));
+    owner = (int *)stackPush(stk, size * sizeof(int));
+    memset(owner, -1, size * sizeof(int));
+    reps = (int *)stackPush(stk, cfg->ncodes * sizeof(int));
+    nreps = mmSymClasses(cfg, sym, reps);
+
+    for (r = 0; r < nreps; r++)
+    {
+        int g = reps[r];
+        uint64_t sig = 0;
+
+        memset(counts, 0, cfg->nfb * sizeof(int));
+        for (i = 0; i < n; i++)
+        {
+            f = mmFeedback(cfg, g, set[i]);
+            counts[f]++;
+            sig = (sig ^ (uint64_t)f) * 1099511628211ULL;
+        }
+        // a guess outside the set that leaves it in one class is useless
+        if (counts[cfg->winFb] == 0 && counts[mmFeedback(cfg, g, set[0])] == n)
+            continue;
+
+        for (i = (int)(sig & (size - 1)); owner[i] >= 0; i = (i + 1) & (size - 1))
+            if (sigs[i] == sig && samePartition(cfg, owner[i], g, set, n))
+                break;
+        if (owner[i] >= 0)
+            continue;
+        sigs[i] = sig;
+        owner[i] = g;
+
+        cand[k].guess = g;
+        cand[k].bound = guessBound(sv, counts, n);
+        cand[k].inSet = counts[cfg->winFb] > 0;
+        k++;
+    }
+    stackPop(stk, reps);
+    stackPop(stk, owner);
+    stackPop(stk, sigs);
+    qsort(cand, k, sizeof(struct candidate), candCompare);
+    return k;
+}
+
+static int solve(struct treeSolver *sv, struct treeStack *stk, const int *set, int n, struct mmFp fp,
+                 const struct mmSymmetry *sym, int bound, int *guessOut);
+
+/* split @set@ by @guess@ into @buf@, with the fingerprint of each class in @fps@ */
+static void splitSet(const struct treeSolver *sv, struct treeStack *stk, const int *set, int n, int guess,
+                     int *buf, int *offs, struct mmFp *fps)
+{
+    uint8_t *fbs = (uint8_t *)stackPush(stk, n);
+    int f, i;
+
+    mmPartition(sv->cfg, guess, set, n, buf, offs, fbs);
+    for (f = 0; f < sv->cfg->nfb; f++)
+    {
+        fps[f].lo = fps[f].hi = 0;
+        for (i = offs[f]; i < offs[f + 1]; i++)
+            mmFpXor(&fps[f], sv->codeFp[buf[i]]);
+    }
+    stackPop(stk, fbs);
+}
+
+/* value of playing @guess@ on @set@, exact if below @bound@ */
+static int evalGuess(struct treeSolver *sv, struct treeStack *stk, const int *set, int n,
+                     const struct mmSymmetry *sym, int guess, int gbound, int bound)
+{
+    const struct mmConfig *cfg = sv->cfg;
+    const struct mmSymmetry *csym = sym;
+    struct mmSymmetry childSym;
+    int offs[MM_MAX_FB + 1], *buf = (int *)stackPush(stk, n * sizeof(int));
+    struct mmFp fps[MM_MAX_FB];
+    int f, acc, g;
+
+    // split the set into contiguous classes by feedback
+    splitSet(sv, stk, set, n, guess, buf, offs, fps);
+
+    // the classes share one history, and so the symmetries that are left
+    if (!mmSymTrivial(cfg, sym) && mmSymRestrict(cfg, sym, guess, &childSym) == 0)
+        csym = &childSym;
+
+    acc = gbound;
+    for (f = 0; f < cfg->nfb; f++)
+    {
+        int k = offs[f + 1] - offs[f], lb = classBound(sv, k), v;
+        if (f == cfg->winFb || k == 0)
+            continue;
+        if (sv->objective == MM_WORST)
+        {
+            v = solve(sv, stk, buf + offs[f], k, fps[f], csym, bound - 1, &g);
+            if (1 + v > acc)
+                acc = 1 + v;
+        }
+        else
+        {
+            v = solve(sv, stk, buf + offs[f], k, fps[f], csym, bound - (acc - lb), &g);
+            acc += v - lb;
+        }
+        if (acc >= bound)
+            break;
+    }
+    if (csym != sym)
+        mmSymFree(&childSym);
+    stackPop(stk, buf);
+    return acc;
+}
+
+/* value of the subset @set@; exact if below @bound@, otherwise some lower bound >= @bound@ */
+static int solve(struct treeSolver *sv, struct treeStack *stk, const int *set, int n, struct mmFp fp,
+                 const struct mmSymmetry *sym, int bound, int *guessOut)
+{
+    struct candidate *cand;
+    int k, i, best = bound, bestGuess = -1, value, exact, guess;
+
+    if (n == 1)
+    {
+        *guessOut = set[0];
+        return 1;
+    }
+    if (classBound(sv, n) >= bound)
+        return classBound(sv, n);
+
+    if (n >= MEMO_MIN)
+    {
+        if (mmMemoGet(sv->memo, fp, &value, &exact, &guess))
+        {
+            if (exact || value >= bound)
+            {
+                __sync_fetch_and_add(&sv->memoHits, 1);
+                *guessOut = guess;
+                return value;
+            }
+        }
+    }
+    __sync_fetch_and_add(&sv->nodes, 1);
+
+    cand = (struct candidate *)stackPush(stk, sv->cfg->ncodes * sizeof(struct candidate));
+    k = listCandidates(sv, stk, set, n, sym, cand);
+    for (i = 0; i < k; i++)
+    {
+        if (cand[i].bound >= best)
+        {
+            __sync_fetch_and_add(&sv->pruned, k - i);
+            break;
+        }
+        value = evalGuess(sv, stk, set, n, sym, cand[i].guess, cand[i].bound, best);
+        if (value < best)
+        {
+            best = value;
+            bestGuess = cand[i].guess;
+        }
+    }
+    stackPop(stk, cand);
+
+    if (n >= MEMO_MIN)
+        mmMemoPut(sv->memo, fp, n, best, bestGuess >= 0, bestGuess);
+    *guessOut = bestGuess;
+    return best;
+}
+
+/* one root guess, run on the work pool */
+static void rootTask(void *ctx, int i, int worker)
+{
+    struct treeSolver *sv = (struct treeSolver *)ctx;
+    struct candidate *c = &sv->rootCand[i];
+    int bound, value;
+
+    // an earlier candidate also wins a tie, so the result does not depend on scheduling
+    pthread_mutex_lock(&sv->rootLock);
+    bound = sv->rootBest;
+    if (bound < INT_MAX && i < sv->rootGuess)
+        bound++;
+    pthread_mutex_unlock(&sv->rootLock);
+    if (c->bound >= bound)
+    {
+        __sync_fetch_and_add(&sv->pruned, 1);
+        return;
+    }
+
+    value = evalGuess(sv, &sv->stacks[worker], sv->root, sv->nroot, &sv->rootSym, c->guess, c->bound, bound);
+
+    pthread_mutex_lock(&sv->rootLock);
+    if (value < bound && (value < sv->rootBest || (value == sv->rootBest && i < sv->rootGuess)))
+    {
+        sv->rootBest = value;
+        sv->rootGuess = i;
+    }
+    pthread_mutex_unlock(&sv->rootLock);
+}
+
+/* ======================================================= */
+/* SECTION: decision tree                                  */
+/* ------------------------------------------------------- */
+
+/* a new node playing @guess@; -1 if the tree cannot grow */
+static int treeAddNode(struct mmTree *tree, int guess)
+{
+    if (tree->nnodes == tree->cap)
+    {
+        int cap = tree->cap ? 2 * tree->cap : 64;
+        int *g = (int *)realloc(tree->guess, cap * sizeof(int)), *next;
+
+        if (g == NULL)
+            return -1;
+        tree->guess = g;
+        next = (int *)realloc(tree->next, (long)cap * tree->nfb * sizeof(int));
+        if (next == NULL)
+            return -1;
+        tree->next = next;
+        tree->cap = cap;
+    }
+    tree->guess[tree->nnodes] = guess;
+    for (int f = 0; f < tree->nfb; f++)
+        tree->next[(long)tree->nnodes * tree->nfb + f] = -1;
+    return tree->nnodes++;
+}
+
+/* add the subtree for @set@, whose values are all in the memo store by now; -1 if the tree cannot grow */
+static int treeBuild(struct treeSolver *sv, struct mmTree *tree, const int *set, int n, struct mmFp fp,
+                     const struct mmSymmetry *sym, int guess, int depth)
+{
+    const struct mmConfig *cfg = sv->cfg;
+    struct treeStack *stk = &sv->stacks[0];
+    struct mmSymmetry childSym;
+    const struct mmSymmetry *csym = sym;
+    struct mmFp fps[MM_MAX_FB];
+    int offs[MM_MAX_FB + 1], node, f, g, *buf;
+
+    if (guess < 0)
+        solve(sv, stk, set, n, fp, sym, INT_MAX, &guess);
+    node = treeAddNode(tree, guess);
+    if (node < 0)
+        return -1;
+    if (!mmSymTrivial(cfg, sym) && mmSymRestrict(cfg, sym, guess, &childSym) == 0)
+        csym = &childSym;
+
+    buf = (int *)stackPush(stk, n * sizeof(int));
+    splitSet(sv, stk, set, n, guess, buf, offs, fps);
+    if (offs[cfg->winFb + 1] > offs[cfg->winFb])
+    {
+        tree->total += depth;
+        if (depth > tree->depth)
+            tree->depth = depth;
+    }
+
+    for (f = 0; f < cfg->nfb; f++)
+    {
+        if (f == cfg->winFb || offs[f + 1] == offs[f])
+            continue;
+        g = treeBuild(sv, tree, buf + offs[f], offs[f + 1] - offs[f], fps[f], csym, -1, depth + 1);
+        if (g < 0)
+        {
+            node = -1;
+            break;
+        }
+        tree->next[(long)node * tree->nfb + f] = g;
+    }
+    stackPop(stk, buf);
+    if (csym != sym)
+        mmSymFree(&childSym);
+    return node;
+}
+
+/* free what mmTreeSolve took, whether or not it got all of it */
+static void treeSolverFree(struct treeSolver *sv, struct mmPool *pool, struct mmMemo *memo, int *all)
+{
+    mmSymFree(&sv->rootSym);
+    if (sv->stacks)
+        for (int w = 0; w < mmPoolSize(pool); w++)
+            free(sv->stacks[w].base);
+    free(sv->stacks);
+    free(sv->rootCand);
+    free(all);
+    pthread_mutex_destroy(&sv->rootLock);
+    free(sv->codeFp);
+    if (memo == NULL)
+        mmMemoClose(sv->memo);
+}
+
+int mmTreeSolve(const struct mmConfig *cfg, struct mmPool *pool, int objective, struct mmMemo *memo,
+                struct mmTree *tree, struct mmTreeStats *st)
+{
+    struct treeSolver sv;
+    struct mmFp rootFp;
+    uint64_t t0 = timeInMicroseconds();
+    int *all, guess, w, value, exact, ok;
+
+    memset(tree, 0, sizeof(*tree));
+    if (cfg->ncodes == 0)
+        return -1;
+
+    memset(&sv, 0, sizeof(sv));
+    sv.cfg = cfg;
+    sv.objective = objective;
+    // all (exact, approx) pairs except the win and (seqlen-1, 1), which cannot occur
+    sv.branch = (cfg->seqlen + 1) * (cfg->seqlen + 2) / 2 - 2;
+    sv.memo = memo ? memo : mmMemoOpen(NULL, cfg, objective);
+    if (sv.memo == NULL)
+        return -1;
+    pthread_mutex_init(&sv.rootLock, NULL);
+    sv.codeFp = (struct mmFp *)malloc(cfg->ncodes * sizeof(struct mmFp));
+    sv.stacks = (struct treeStack *)calloc(mmPoolSize(pool), sizeof(struct treeStack));
+    all = (int *)malloc(cfg->ncodes * sizeof(int));
+    sv.rootCand = (struct candidate *)malloc(cfg->ncodes * sizeof(struct candidate));
+    ok = sv.codeFp && sv.stacks && all && sv.rootCand && mmSymInit(cfg, &sv.rootSym) == 0;
+    for (w = 0; ok && w < mmPoolSize(pool); w++)
+    {
+        sv.stacks[w].cap = (size_t)STACK_LEVELS * cfg->ncodes * (sizeof(struct candidate) + sizeof(int) + 1);
+        sv.stacks[w].base = (char *)malloc(sv.stacks[w].cap);
+        ok = sv.stacks[w].base != NULL;
+    }
+    if (!ok)
+    {
+        treeSolverFree(&sv, pool, memo, all);
+        return -1;
+    }
+
+    for (w = 0; w < cfg->ncodes; w++)
+        sv.codeFp[w] = mmFpCode(w);
+    sv.root = all;
+    sv.nroot = mmAllCodes(cfg, all);
+    sv.rootBest = INT_MAX;
+    sv.rootGuess = -1;
+    rootFp = mmFpSet(all, sv.nroot);
+
+    // a previous run may have solved the root already
+    if (sv.nroot == 1)
+        guess = all[0];
+    else if (mmMemoGet(sv.memo, rootFp, &value, &exact, &guess) && exact)
+        sv.memoHits++;
+    else
+    {
+        int k = listCandidates(&sv, &sv.stacks[0], all, sv.nroot, &sv.rootSym, sv.rootCand);
+        mmPoolFor(pool, k, rootTask, &sv);
+        guess = sv.rootCand[sv.rootGuess].guess;
+        mmMemoPut(sv.memo, rootFp, sv.nroot, sv.rootBest, 1, guess);
+    }
+
+    tree->nfb = cfg->nfb;
+    ok = treeBuild(&sv, tree, all, sv.nroot, rootFp, &sv.rootSym, guess, 1) >= 0;
+
+    if (st)
+    {
+        st->nodes = sv.nodes;
+        st->memoHits = sv.memoHits;
+        st->pruned = sv.pruned;
+        st->usec = timeInMicroseconds() - t0;
+    }
+
+    treeSolverFree(&sv, pool, memo, all);
+    if (!ok)
+    {
+        mmTreeFree(tree);
+        return -1;
+    }
+    return 0;
+}
+
+void mmTreeFree(struct mmTree *tree)
+{
+    free(tree->guess);
+    free(tree->next);
+    memset(tree, 0, sizeof(*tree));
+}
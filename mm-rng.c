@@ -0,0 +1,114 @@
+/*
+ * Random numbers for games, simulations and the randomised solvers: the
+ * xoshiro256** generator, which is fast, has a period of 2^256 - 1, and
+ * can jump 2^128 numbers ahead, so every thread or chunk of work gets its
+ * own stream with no lock and no overlap. Unlike rand(), it has no global
+ * state, and unlike `rand() % n`, mmRngBelow() has no bias for any n.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm-solver.h"
+
+// codes drawn per task on the work pool, each from a stream of its own
+#define RNG_CHUNK (1 << 16)
+
+/* ======================================================= */
+/* SECTION: generator                                      */
+/* ------------------------------------------------------- */
+
+void mmRngSeed(struct mmRng *r, uint64_t seed)
+{
+    // the state is the splitmix64 sequence of the seed, which is never all zero
+    for (int i = 0; i < 4; i++)
+        r->s[i] = mmSplitMix(seed + i * 0x9e3779b97f4a7c15ULL);
+}
+
+void mmRngJump(struct mmRng *r)
+{
+    static const uint64_t jump[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL,
+                                    0x39abdc4529b1661cULL};
+    uint64_t s[4] = {0, 0, 0, 0};
+
+    for (int i = 0; i < 4; i++)
+        for (int b = 0; b < 64; b++)
+        {
+            if (jump[i] & (1ULL << b))
+                for (int k = 0; k < 4; k++)
+                    s[k] ^= r->s[k];
+            mmRngNext(r);
+        }
+    memcpy(r->s, s, sizeof(s));
+}
+
+/* ======================================================= */
+/* SECTION: codes                                          */
+/* ------------------------------------------------------- */
+
+void mmRngDigits(struct mmRng *r, const struct mmConfig *cfg, int noRepeat, uint8_t *digits)
+{
+    uint8_t pool[MM_MAX_COLS];
+
+    if (!noRepeat)
+    {
+        for (int j = 0; j < cfg->seqlen; j++)
+            digits[j] = mmRngBelow(r, cfg->colors);
+        return;
+    }
+    // the first seqlen colours of a random shuffle
+    for (int c = 0; c < cfg->colors; c++)
+        pool[c] = c;
+    for (int j = 0; j < cfg->seqlen; j++)
+    {
+        int k = j + mmRngBelow(r, cfg->colors - j);
+        uint8_t t = pool[j];
+        pool[j] = pool[k];
+        pool[k] = t;
+        digits[j] = pool[j];
+    }
+}
+
+struct rngCodes
+{
+    uint32_t ncodes;
+    uint32_t *codes;
+    long n;
+    const struct mmRng *streams; // one per chunk
+};
+
+static void rngCodesTask(void *ctx, int chunk, int worker)
+{
+    struct rngCodes *rc = (struct rngCodes *)ctx;
+    struct mmRng r = rc->streams[chunk];
+    long i = (long)chunk * RNG_CHUNK, end = i + RNG_CHUNK < rc->n ? i + RNG_CHUNK : rc->n;
+
+    (void)worker;
+    for (; i < end; i++)
+        rc->codes[i] = mmRngBelow(&r, rc->ncodes);
+}
+
+int mmRngCodes(const struct mmConfig *cfg, struct mmPool *pool, uint64_t seed, uint32_t *codes, long n)
+{
+    int nchunks = (int)((n + RNG_CHUNK - 1) / RNG_CHUNK);
+    struct mmRng *streams, r;
+    struct rngCodes rc;
+
+    if (cfg->ncodes == 0 || n < 0 || (streams = (struct mmRng *)malloc((nchunks + 1) * sizeof(struct mmRng))) == NULL)
+        return -1;
+    mmRngSeed(&r, seed);
+    for (int c = 0; c < nchunks; c++)
+    {
+        streams[c] = r;
+        mmRngJump(&r);
+    }
+    rc.ncodes = cfg->ncodes;
+    rc.codes = codes;
+    rc.n = n;
+    rc.streams = streams;
+    mmPoolFor(pool, nchunks, rngCodesTask, &rc);
+    free(streams);
+    return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * Guess selection from a random sample of the candidates.
+ *
+ * With millions of candidates left, scoring each guess against all of them
+ * is too slow. Instead, the class sizes of a guess are estimated from a
+ * random sample, with confidence bounds, and the guesses are raced: after
+ * each round, the guesses that are surely worse than the current leader
+ * are dropped, and the sample is doubled for the others, until one guess
+ * is left, none of the others can be more than a small margin better than
+ * the leader, or the sample is the whole set (and the scores exact).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "mm-solver.h"
+
+// first sample size
+#define SAMPLE_MIN 256
+// width of the confidence bounds in standard deviations (about 99% each)
+#define SAMPLE_Z 2.576
+// the race is over when no guess can beat the leader by more than this fraction of its score
+#define SAMPLE_TOLERANCE 0.05
+
+void mmEstimateGuess(const struct mmConfig *cfg, int guess, const int *sample, int m, int n,
+                     struct mmEstimate *est)
+{
+    int counts[MM_MAX_FB], f, singles = 0;
+    // without replacement, the variance shrinks to 0 as the sample grows to the set
+    double fpc = n > 1 ? sqrt((double)(n - m) / (n - 1)) : 0.0;
+    double h = 0.0, h2 = 0.0, sd;
+
+    mmPartitionCounts(cfg, guess, sample, m, counts);
+    memset(est, 0, sizeof(*est));
+    est->samples = m;
+    for (f = 0; f < cfg->nfb; f++)
+    {
+        double p = (double)counts[f] / m, d;
+
+        if (counts[f] == 0)
+            continue;
+        est->parts++;
+        if (counts[f] == 1)
+            singles++;
+        // class size n * p, give or take the standard error of p
+        d = SAMPLE_Z * sqrt(p * (1.0 - p) / m) * fpc;
+        if (p * n > est->worst)
+            est->worst = p * n;
+        if ((p - d) * n > est->worstLo)
+            est->worstLo = (p - d) * n;
+        if ((p + d) * n > est->worstHi)
+            est->worstHi = (p + d) * n;
+        h -= p * log2(p);
+        h2 += p * log2(p) * log2(p);
+    }
+    if (est->worstHi > n)
+        est->worstHi = n;
+
+    // the plug-in entropy is biased low: the Miller-Madow correction, which vanishes with the
+    // variance as the sample grows to the set, and the delta-method variance; as the correction
+    // is itself an estimate, the bounds reach from the plug-in value to the corrected one
+    sd = m < n ? SAMPLE_Z * sqrt((h2 - h * h) / m) * fpc : 0.0;
+    est->entropyLo = h - sd;
+    if (m < n)
+        h += (est->parts - 1) / (2.0 * m * log(2.0)) * fpc * fpc;
+    est->entropy = h;
+    est->entropyHi = h + sd;
+
+    // classes seen once hint at classes not seen at all
+    est->partsHi = m < n ? est->parts + singles : est->parts;
+    if (est->partsHi > cfg->nfb)
+        est->partsHi = cfg->nfb;
+}
+
+/* @a@ is better than @b@ on the point estimates */
+static int estimateBetter(int mode, const struct mmEstimate *a, const struct mmEstimate *b)
+{
+    switch (mode)
+    {
+    case MM_ENTROPY:
+        return a->entropy > b->entropy + 1e-12;
+    case MM_PARTS:
+        return a->parts > b->parts;
+    default:
+        return a->worst < b->worst;
+    }
+}
+
+/* @a@ is worse than @b@, even at the best of its bounds and the worst of those of @b@ */
+static int estimateSurelyWorse(int mode, const struct mmEstimate *a, const struct mmEstimate *b)
+{
+    switch (mode)
+    {
+    case MM_ENTROPY:
+        return a->entropyHi < b->entropyLo;
+    case MM_PARTS:
+        return a->partsHi < b->parts;
+    default:
+        return a->worstLo > b->worstHi;
+    }
+}
+
+/* how much better than the leader @lead@ @a@ can still be, as a fraction of the leader's score */
+static double estimateGap(int mode, const struct mmEstimate *a, const struct mmEstimate *lead)
+{
+    switch (mode)
+    {
+    case MM_ENTROPY:
+        return lead->entropy > 0 ? (a->entropyHi - lead->entropyLo) / lead->entropy : 1.0;
+    case MM_PARTS:
+        return (double)(a->partsHi - lead->parts) / lead->parts;
+    default:
+        return lead->worst > 0 ? (lead->worstHi - a->worstLo) / lead->worst : 0.0;
+    }
+}
+
+int mmSelectGuessSampled(const struct mmConfig *cfg, int mode, const int *set, int n,
+                         const int *guesses, int ng, int maxSamples, uint64_t seed,
+                         struct mmEstimate *best, struct mmSampleStats *st)
+{
+    uint64_t start = timeInMicroseconds();
+    struct mmEstimate *est;
+    int *sample, *alive, nalive, drawn = 0, m, lead = 0, i, k;
+    double gap;
+    long scored = 0;
+    int rounds = 0;
+    struct mmRng r;
+
+    if (guesses == NULL)
+        ng = cfg->ncodes;
+    if (n == 0 || ng == 0)
+        return -1;
+    if (maxSamples <= 0 || maxSamples > n)
+        maxSamples = n;
+    sample = (int *)malloc(n * sizeof(int));
+    alive = (int *)malloc(ng * sizeof(int));
+    est = (struct mmEstimate *)malloc(ng * sizeof(struct mmEstimate));
+    if (sample == NULL || alive == NULL || est == NULL)
+    {
+        free(est);
+        free(alive);
+        free(sample);
+        return -1;
+    }
+    memcpy(sample, set, n * sizeof(int));
+    mmRngSeed(&r, seed);
+    for (i = 0; i < ng; i++)
+        alive[i] = i;
+    nalive = ng;
+
+    for (m = SAMPLE_MIN < maxSamples ? SAMPLE_MIN : maxSamples;; m = 2 * m < maxSamples ? 2 * m : maxSamples)
+    {
+        // grow the sample: a prefix of a random permutation of the set
+        for (; drawn < m; drawn++)
+        {
+            int j = drawn + mmRngBelow(&r, n - drawn), t = sample[drawn];
+            sample[drawn] = sample[j];
+            sample[j] = t;
+        }
+
+        lead = alive[0];
+        for (i = 0; i < nalive; i++)
+        {
+            int g = alive[i];
+            mmEstimateGuess(cfg, guesses ? guesses[g] : g, sample, m, n, &est[g]);
+            if (estimateBetter(mode, &est[g], &est[lead]))
+                lead = g;
+        }
+        scored += (long)nalive * m;
+        rounds++;
+
+        // race: drop the guesses that are surely worse than the leader
+        gap = 0.0;
+        for (i = k = 0; i < nalive; i++)
+            if (!estimateSurelyWorse(mode, &est[alive[i]], &est[lead]))
+            {
+                alive[k++] = alive[i];
+                if (alive[i] != lead && estimateGap(mode, &est[alive[i]], &est[lead]) > gap)
+                    gap = estimateGap(mode, &est[alive[i]], &est[lead]);
+            }
+        nalive = k;
+        if (nalive == 1 || gap <= SAMPLE_TOLERANCE || m == maxSamples)
+            break;
+    }
+
+    if (best)
+        *best = est[lead];
+    if (st)
+    {
+        st->rounds = rounds;
+        st->samples = m;
+        st->left = nalive;
+        st->scored = scored;
+        st->usec = timeInMicroseconds() - start;
+    }
+    free(est);
+    free(alive);
+    free(sample);
+    return guesses ? guesses[lead] : lead;
+}
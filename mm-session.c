@@ -0,0 +1,135 @@
+/*
+ * Game sessions as small resumable state machines, so that one thread can
+ * keep a great many games going at once, interleaved, with no thread or
+ * process per game.
+ *
+ * A session is a few dozen bytes: the secret as a code index, the guesses
+ * and answers so far, and a state. Each step moves one session by one
+ * transition (draw a secret, make a guess, answer it), and returns, so a
+ * scheduler can step the sessions in any order. The built-in player guesses
+ * the first code, in increasing order, that is consistent with all the
+ * answers so far; it needs no state but the guesses themselves, as every
+ * code before the last guess is known to be inconsistent already.
+ *
+ * A session is not a struct mmGame, which is several times larger with its
+ * generator, adversary and log; but it is answered by the rules of the game
+ * engine (see mm-game.c), so the two cannot disagree on a game's outcome.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm-solver.h"
+
+/* ======================================================= */
+/* SECTION: one session                                    */
+/* ------------------------------------------------------- */
+
+void mmSessionStart(const struct mmConfig *cfg, struct mmSession *s, struct mmRng *rng)
+{
+    s->secret = mmRngBelow(rng, cfg->ncodes);
+    s->attempts = 0;
+    s->state = MM_SESSION_GUESS;
+}
+
+int mmSessionAnswer(const struct mmConfig *cfg, struct mmSession *s, int guess, int maxAttempts)
+{
+    int fb;
+
+    if (s->state != MM_SESSION_GUESS || guess < 0 || guess >= cfg->ncodes)
+        return -1;
+    fb = mmFeedback(cfg, guess, s->secret);
+    s->guesses[s->attempts] = guess;
+    s->fbs[s->attempts] = fb;
+    s->attempts++;
+    switch (mmGameOutcome(cfg, fb, s->attempts, maxAttempts))
+    {
+    case MM_GAME_WON:
+        s->state = MM_SESSION_WON;
+        break;
+    case MM_GAME_LOST:
+        s->state = MM_SESSION_LOST;
+        break;
+    }
+    return fb;
+}
+
+/* the first code from @from@ on that gives all the answers of @s@ */
+static int sessionConsistent(const struct mmConfig *cfg, const struct mmSession *s, int from)
+{
+    for (int c = from; c < cfg->ncodes; c++)
+    {
+        int k = 0;
+        while (k < s->attempts && mmFeedback(cfg, s->guesses[k], c) == s->fbs[k])
+            k++;
+        if (k == s->attempts)
+            return c;
+    }
+    return -1;
+}
+
+/* ======================================================= */
+/* SECTION: sets of sessions                               */
+/* ------------------------------------------------------- */
+
+int mmSessionsInit(struct mmSessionSet *ss, const struct mmConfig *cfg, long n, int maxAttempts, uint64_t seed)
+{
+    memset(ss, 0, sizeof(*ss));
+    if (cfg->ncodes == 0 || cfg->ncodes > MM_SESSION_MAX_CODES || n < 1 || maxAttempts < 1 ||
+        maxAttempts > MM_SESSION_HISTORY)
+        return -1;
+    if ((ss->sessions = (struct mmSession *)calloc(n, sizeof(struct mmSession))) == NULL)
+        return -1;
+    ss->cfg = cfg;
+    ss->n = n;
+    ss->maxAttempts = maxAttempts;
+    mmRngSeed(&ss->rng, seed);
+    return 0;
+}
+
+void mmSessionsFree(struct mmSessionSet *ss)
+{
+    free(ss->sessions);
+    ss->sessions = NULL;
+}
+
+int mmSessionStep(struct mmSessionSet *ss, struct mmSession *s)
+{
+    const struct mmConfig *cfg = ss->cfg;
+    int guess;
+
+    ss->steps++;
+    switch (s->state)
+    {
+    case MM_SESSION_NEW:
+        mmSessionStart(cfg, s, &ss->rng);
+        break;
+    case MM_SESSION_GUESS:
+        guess = s->attempts == 0 ? 0 : sessionConsistent(cfg, s, s->guesses[s->attempts - 1] + 1);
+        mmSessionAnswer(cfg, s, guess, ss->maxAttempts);
+        break;
+    case MM_SESSION_WON:
+        ss->won++;
+        ss->guesses += s->attempts;
+        s->state = MM_SESSION_NEW;
+        break;
+    case MM_SESSION_LOST:
+        ss->lost++;
+        s->state = MM_SESSION_NEW;
+        break;
+    }
+    return s->state;
+}
+
+long mmSessionsRun(struct mmSessionSet *ss, long steps)
+{
+    long done = 0;
+
+    // round robin, one transition of each session in turn
+    while (done < steps)
+        for (long i = 0; i < ss->n && done < steps; i++, done++)
+            mmSessionStep(ss, &ss->sessions[i]);
+    return done;
+}
@@ -0,0 +1,536 @@
+/*
+ * Core of the solver engine: code tables, scoring, candidate filtering,
+ * guess selection and a small pthread work pool.
+ * See mm-solver.h for the representation of codes and feedback.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include <unistd.h>
+#include <pthread.h>
+
+#include "mm-solver.h"
+
+// codes per 64-bit word of the index from which filtering through it beats the multiset groups
+#define FILTER_INDEX_MIN 32
+
+// codes an anytime selection scores between two looks at the clock
+#define ANYTIME_CHUNK 1024
+
+/* ======================================================= */
+/* SECTION: configuration and scoring                      */
+/* ------------------------------------------------------- */
+
+int mmConfigInit(struct mmConfig *cfg, int colors, int seqlen)
+{
+    long n = 1;
+    int i, j, c;
+
+    memset(cfg, 0, sizeof(*cfg));
+    if (colors < 1 || colors > MM_MAX_COLS || seqlen < 1 || seqlen > MM_MAX_SEQL)
+        return -1;
+
+    cfg->colors = colors;
+    cfg->seqlen = seqlen;
+    cfg->nfb = (seqlen + 1) * (seqlen + 1);
+    cfg->winFb = mmFbId(cfg, seqlen, 0);
+
+    // size of the code space, stopping once it is too large to enumerate
+    for (i = 0; i < seqlen && n <= MM_MAX_CODES; i++)
+        n *= colors;
+    if (n > MM_MAX_CODES)
+        return 0;
+    cfg->ncodes = (int)n;
+
+    // digit table; code 0 is all colour 0, and the last position varies fastest
+    cfg->digits = (uint8_t *)malloc((size_t)n * seqlen);
+    if (cfg->digits == NULL)
+        return -1;
+    for (c = 0; c < cfg->ncodes; c++)
+    {
+        int v = c;
+        for (j = seqlen - 1; j >= 0; j--)
+        {
+            cfg->digits[(long)c * seqlen + j] = v % colors;
+            v /= colors;
+        }
+    }
+
+    // full feedback table for small code spaces
+    if (cfg->ncodes <= MM_MAX_TABLE)
+    {
+        cfg->fbTable = (uint8_t *)malloc((size_t)n * n);
+        if (cfg->fbTable == NULL)
+        {
+            free(cfg->digits);
+            cfg->digits = NULL;
+            return -1;
+        }
+        for (c = 0; c < cfg->ncodes; c++)
+            for (j = 0; j < cfg->ncodes; j++)
+                cfg->fbTable[(long)c * n + j] =
+                    mmScoreDigits(cfg, cfg->digits + (long)c * seqlen, cfg->digits + (long)j * seqlen);
+    }
+    // otherwise, big sets are filtered through an index; without one, they are rescored
+    else
+        mmIndexAttach(cfg);
+    return 0;
+}
+
+void mmConfigFree(struct mmConfig *cfg)
+{
+    mmIndexDetach(cfg);
+    free(cfg->digits);
+    free(cfg->fbTable);
+    cfg->digits = NULL;
+    cfg->fbTable = NULL;
+}
+
+/* same result as countMatches(), as a feedback id instead of concat(exact, approx) */
+int mmScoreDigits(const struct mmConfig *cfg, const uint8_t *a, const uint8_t *b)
+{
+    int ca[MM_MAX_COLS] = {0}, cb[MM_MAX_COLS] = {0};
+    int i, exact = 0, common = 0;
+
+    for (i = 0; i < cfg->seqlen; i++)
+    {
+        if (a[i] == b[i])
+            exact++;
+        ca[a[i]]++;
+        cb[b[i]]++;
+    }
+    // colours in common, regardless of position
+    for (i = 0; i < cfg->colors; i++)
+        common += ca[i] < cb[i] ? ca[i] : cb[i];
+
+    return mmFbId(cfg, exact, common - exact);
+}
+
+void mmScoreBatch(const struct mmConfig *cfg, const uint8_t *guess, const uint8_t *codes, int n, uint8_t *out)
+{
+    int gc[MM_MAX_COLS] = {0}, cc[MM_MAX_COLS];
+    int i, j, c, exact, common;
+
+    for (j = 0; j < cfg->seqlen; j++)
+        gc[guess[j]]++;
+    for (i = 0; i < n; i++, codes += cfg->seqlen)
+    {
+        memset(cc, 0, cfg->colors * sizeof(int));
+        exact = 0;
+        for (j = 0; j < cfg->seqlen; j++)
+        {
+            exact += codes[j] == guess[j];
+            cc[codes[j]]++;
+        }
+        common = 0;
+        for (c = 0; c < cfg->colors; c++)
+            common += cc[c] < gc[c] ? cc[c] : gc[c];
+        out[i] = mmFbId(cfg, exact, common - exact);
+    }
+}
+
+void mmCodeToSeq(const struct mmConfig *cfg, int code, int *seq)
+{
+    for (int j = cfg->seqlen - 1; j >= 0; j--)
+    {
+        seq[j] = code % cfg->colors + 1;
+        code /= cfg->colors;
+    }
+}
+
+int mmSeqToCode(const struct mmConfig *cfg, const int *seq)
+{
+    int code = 0;
+    for (int j = 0; j < cfg->seqlen; j++)
+        code = code * cfg->colors + (seq[j] - 1);
+    return code;
+}
+
+int mmDigitsToCode(const struct mmConfig *cfg, const uint8_t *digits)
+{
+    int code = 0;
+    for (int j = 0; j < cfg->seqlen; j++)
+        code = code * cfg->colors + digits[j];
+    return code;
+}
+
+/* ======================================================= */
+/* SECTION: candidate sets and guess selection             */
+/* ------------------------------------------------------- */
+
+int mmAllCodes(const struct mmConfig *cfg, int *set)
+{
+    for (int i = 0; i < cfg->ncodes; i++)
+        set[i] = i;
+    return cfg->ncodes;
+}
+
+int mmFilter(const struct mmConfig *cfg, int *set, int n, int guess, int fb)
+{
+    int k = 0;
+
+    // the index pays on sets of most of the code space, the multiset groups from a code per group on
+    if (cfg->index && n >= FILTER_INDEX_MIN * cfg->index->words)
+        return mmIndexFilterSet(cfg->index, set, n, guess, fb);
+    if (cfg->multiset && n >= cfg->multiset->ngroups && (k = mmMultisetFilter(cfg->multiset, set, n, guess, fb)) >= 0)
+        return k;
+    k = 0;
+    for (int i = 0; i < n; i++)
+        if (mmFeedback(cfg, guess, set[i]) == fb)
+            set[k++] = set[i];
+    return k;
+}
+
+void mmPartitionCounts(const struct mmConfig *cfg, int guess, const int *set, int n, int *counts)
+{
+    memset(counts, 0, cfg->nfb * sizeof(int));
+    for (int i = 0; i < n; i++)
+        counts[mmFeedback(cfg, guess, set[i])]++;
+}
+
+/* two passes: the feedback of each code is computed once into @fbs@, then the
+   codes are scattered to the start of their class, which keeps them in order */
+void mmPartition(const struct mmConfig *cfg, int guess, const int *set, int n, int *out, int *offs, uint8_t *fbs)
+{
+    int pos[MM_MAX_FB], f, i;
+
+    memset(offs, 0, (cfg->nfb + 1) * sizeof(int));
+    for (i = 0; i < n; i++)
+    {
+        fbs[i] = mmFeedback(cfg, guess, set[i]);
+        offs[fbs[i] + 1]++;
+    }
+    for (f = 0; f < cfg->nfb; f++)
+    {
+        offs[f + 1] += offs[f];
+        pos[f] = offs[f];
+    }
+    for (i = 0; i < n; i++)
+        out[pos[fbs[i]]++] = set[i];
+}
+
+/* score a guess from the sizes @counts@ of its classes in a set of @n@ codes */
+static void scoreCounts(const struct mmConfig *cfg, const int *counts, int n, struct mmGuessScore *sc)
+{
+    double h = 0.0;
+
+    sc->worst = 0;
+    sc->parts = 0;
+    for (int f = 0; f < cfg->nfb; f++)
+    {
+        if (counts[f] == 0)
+            continue;
+        sc->parts++;
+        if (counts[f] > sc->worst)
+            sc->worst = counts[f];
+        h -= (double)counts[f] / n * log2((double)counts[f] / n);
+    }
+    sc->entropy = h;
+    sc->inSet = counts[cfg->winFb] > 0;
+}
+
+void mmScoreGuess(const struct mmConfig *cfg, int guess, const int *set, int n, struct mmGuessScore *sc)
+{
+    int counts[MM_MAX_FB];
+
+    mmPartitionCounts(cfg, guess, set, n, counts);
+    scoreCounts(cfg, counts, n, sc);
+}
+
+int mmGuessBetter(int mode, const struct mmGuessScore *a, const struct mmGuessScore *b)
+{
+    switch (mode)
+    {
+    case MM_ENTROPY:
+        if (a->entropy > b->entropy + 1e-12)
+            return 1;
+        if (a->entropy < b->entropy - 1e-12)
+            return 0;
+        break;
+    case MM_PARTS:
+        if (a->parts != b->parts)
+            return a->parts > b->parts;
+        break;
+    default:
+        if (a->worst != b->worst)
+            return a->worst < b->worst;
+        break;
+    }
+    // on a tie, prefer a guess that may win straight away
+    return a->inSet > b->inSet;
+}
+
+int mmSelectGuess(const struct mmConfig *cfg, int mode, const int *set, int n,
+                  const int *guesses, int ng, struct mmGuessScore *best)
+{
+    struct mmGuessScore sc, top;
+    int bestGuess = -1;
+
+    if (guesses == NULL)
+        ng = cfg->ncodes;
+    for (int i = 0; i < ng; i++)
+    {
+        int g = guesses ? guesses[i] : i;
+        mmScoreGuess(cfg, g, set, n, &sc);
+        if (bestGuess < 0 || mmGuessBetter(mode, &sc, &top))
+        {
+            top = sc;
+            bestGuess = g;
+        }
+    }
+    if (best && bestGuess >= 0)
+        *best = top;
+    return bestGuess;
+}
+
+// an anytime selection in progress
+struct anytime
+{
+    const struct mmConfig *cfg;
+    int mode;
+    const int *set;
+    int n;
+    uint64_t budget, start;
+    uint64_t now;  // time of the last look at the clock
+    uint64_t cost; // time the last guess took to score
+    struct mmGuessScore top;
+    int bestGuess, covered, out;
+};
+
+/* true once a guess that takes as long as the last one would end after the deadline */
+static int anytimeOut(struct anytime *a)
+{
+    a->now = timeInMicroseconds();
+    return a->out = a->budget && a->now - a->start + a->cost > a->budget;
+}
+
+/* score @guess@ against the set, a chunk of it at a time, so that a guess against a
+   big set is given up when the deadline comes, and keep it if it is the best so far */
+static void anytimeTry(struct anytime *a, int guess)
+{
+    const struct mmConfig *cfg = a->cfg;
+    struct mmGuessScore sc;
+    int counts[MM_MAX_FB];
+    uint64_t t = a->now;
+
+    memset(counts, 0, cfg->nfb * sizeof(int));
+    for (int i = 0; i < a->n; i += ANYTIME_CHUNK)
+    {
+        int end = i + ANYTIME_CHUNK < a->n ? i + ANYTIME_CHUNK : a->n;
+
+        if (i > 0 && a->budget && (a->now = timeInMicroseconds()) - a->start >= a->budget)
+        {
+            a->out = 1;
+            return;
+        }
+        for (int k = i; k < end; k++)
+            counts[mmFeedback(cfg, guess, a->set[k])]++;
+    }
+    scoreCounts(cfg, counts, a->n, &sc);
+    a->covered++;
+    if (a->bestGuess < 0 || mmGuessBetter(a->mode, &sc, &a->top))
+    {
+        a->top = sc;
+        a->bestGuess = guess;
+    }
+    a->now = timeInMicroseconds();
+    a->cost = a->now - t;
+}
+
+/* the candidates come first: they may win straight away, and usually split the
+   set well, so a good guess is known early on; then the other guesses, and last
+   the candidates that are equivalent to one scored already. The classes are
+   enumerated as they are needed, so the deadline is first checked before any
+   work that grows with the code space */
+int mmSelectGuessAnytime(const struct mmConfig *cfg, int mode, const int *set, int n,
+                         const struct mmSymmetry *sym, uint64_t budget,
+                         struct mmGuessScore *best, struct mmAnytimeStats *st)
+{
+    struct anytime a = {cfg, mode, set, n, budget, timeInMicroseconds(), 0, 0, {0, 0, 0.0, 0}, -1, 0, 0};
+    int trivial = sym == NULL || mmSymTrivial(cfg, sym), complete = 0, i, c;
+    uint64_t *isCand;
+
+    a.now = a.start;
+    // the candidates that represent their class
+    for (i = 0; i < n && !anytimeOut(&a); i++)
+        if (trivial || mmSymCanonical(cfg, sym, set[i]) == set[i])
+            anytimeTry(&a, set[i]);
+
+    // one guess per class of the other codes
+    if (!a.out && (isCand = (uint64_t *)calloc((cfg->ncodes + 63) / 64, sizeof(uint64_t))) != NULL)
+    {
+        for (i = 0; i < n; i++)
+            isCand[set[i] >> 6] |= 1ULL << (set[i] & 63);
+        for (c = 0; c < cfg->ncodes && !anytimeOut(&a); c++)
+            if (!((isCand[c >> 6] >> (c & 63)) & 1) && (trivial || mmSymCanonical(cfg, sym, c) == c))
+                anytimeTry(&a, c);
+        free(isCand);
+        complete = !a.out;
+    }
+
+    // the other candidates: they score as their representative does, but any of them may be the secret
+    for (i = 0; i < n && !trivial && !a.out && !anytimeOut(&a); i++)
+        if (mmSymCanonical(cfg, sym, set[i]) != set[i])
+            anytimeTry(&a, set[i]);
+
+    if (best && a.covered > 0)
+        *best = a.top;
+    if (st)
+    {
+        st->covered = a.covered;
+        // the number of classes is only known once they were all enumerated, unless there is no symmetry
+        st->total = trivial ? cfg->ncodes : complete && !a.out ? a.covered : 0;
+        st->usec = a.now - a.start;
+    }
+    // the deadline came before any guess was scored
+    return a.bestGuess >= 0 ? a.bestGuess : n > 0 ? set[0] : -1;
+}
+
+/* ======================================================= */
+/* SECTION: work pool                                      */
+/* ------------------------------------------------------- */
+
+struct mmPool
+{
+    int nthreads;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start, done;
+    // the current job; workers pick indices from @next@ until @n@ is reached
+    void (*fn)(void *ctx, int i, int worker);
+    void *ctx;
+    int n, next;
+    int generation, busy, quit;
+};
+
+struct mmWorkerArg
+{
+    struct mmPool *pool;
+    int id;
+};
+
+static void poolRunJob(struct mmPool *pool, int worker)
+{
+    int i;
+    while ((i = __sync_fetch_and_add(&pool->next, 1)) < pool->n)
+        pool->fn(pool->ctx, i, worker);
+}
+
+static void *poolWorker(void *p)
+{
+    struct mmWorkerArg *arg = (struct mmWorkerArg *)p;
+    struct mmPool *pool = arg->pool;
+    int id = arg->id, seen = 0;
+
+    free(arg);
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->quit && pool->generation == seen)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if (pool->quit)
+            break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        poolRunJob(pool, id);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+struct mmPool *mmPoolCreate(int nthreads)
+{
+    struct mmPool *pool = (struct mmPool *)calloc(1, sizeof(struct mmPool));
+    if (pool == NULL)
+        return NULL;
+
+    if (nthreads <= 0)
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads <= 0)
+        nthreads = 1;
+    pool->nthreads = nthreads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    // the calling thread is worker 0; the pool runs with the workers that could be started
+    pool->threads = (pthread_t *)malloc(nthreads * sizeof(pthread_t));
+    if (pool->threads == NULL)
+        pool->nthreads = 1;
+    for (int i = 1; i < pool->nthreads; i++)
+    {
+        struct mmWorkerArg *arg = (struct mmWorkerArg *)malloc(sizeof(struct mmWorkerArg));
+        if (arg == NULL)
+        {
+            pool->nthreads = i;
+            break;
+        }
+        arg->pool = pool;
+        arg->id = i;
+        if (pthread_create(&pool->threads[i], NULL, poolWorker, arg) != 0)
+        {
+            free(arg);
+            pool->nthreads = i;
+            break;
+        }
+    }
+    return pool;
+}
+
+int mmPoolSize(const struct mmPool *pool)
+{
+    return pool ? pool->nthreads : 1;
+}
+
+void mmPoolFor(struct mmPool *pool, int n, void (*fn)(void *ctx, int i, int worker), void *ctx)
+{
+    if (pool == NULL || pool->nthreads == 1)
+    {
+        for (int i = 0; i < n; i++)
+            fn(ctx, i, 0);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->n = n;
+    pool->next = 0;
+    pool->busy = pool->nthreads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    poolRunJob(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void mmPoolDestroy(struct mmPool *pool)
+{
+    if (pool == NULL)
+        return;
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->nthreads; i++)
+        pthread_join(pool->threads[i], NULL);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool);
+}
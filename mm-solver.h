@@ -0,0 +1,964 @@
+/*
+ * Solver engine for the MasterMind game.
+ *
+ * Codes are handled as an index in [0, colors^seqlen), with the colour of
+ * each position stored as a 0-based digit (the game itself uses 1..COLS).
+ * Feedback is a small id, exact * (seqlen + 1) + approx, so it can be used
+ * directly as an index into partition histograms.
+ */
+
+#ifndef MM_SOLVER_H
+#define MM_SOLVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* ======================================================= */
+/* SECTION: constants                                      */
+/* ------------------------------------------------------- */
+
+// largest supported number of colours and sequence length
+#define MM_MAX_COLS 16
+#define MM_MAX_SEQL 16
+// largest number of feedback ids, (MM_MAX_SEQL+1)^2
+#define MM_MAX_FB ((MM_MAX_SEQL + 1) * (MM_MAX_SEQL + 1))
+// largest code space that is enumerated into a digit table
+#define MM_MAX_CODES (1 << 22)
+// largest code space for which the full feedback table is precomputed
+#define MM_MAX_TABLE 4096
+// largest filtering index made for a code space without the feedback table, in bytes
+#define MM_MAX_INDEX (64 << 20)
+
+// guess-selection criteria
+#define MM_MINIMAX 0 // smallest worst-case partition (Knuth)
+#define MM_ENTROPY 1 // largest partition entropy
+#define MM_PARTS 2   // largest number of non-empty partitions
+
+// objectives for the optimal decision tree
+#define MM_EXPECTED 0 // minimal total (and so expected) number of guesses
+#define MM_WORST 1    // minimal worst-case number of guesses
+
+/* ======================================================= */
+/* SECTION: configuration and scoring                      */
+/* ------------------------------------------------------- */
+
+struct mmIndex;
+struct mmMultiset;
+
+struct mmConfig
+{
+    int colors, seqlen;
+    int ncodes;                  // colors^seqlen, 0 if too large to enumerate
+    int nfb;                     // number of feedback ids
+    int winFb;                   // feedback id of an all-exact answer
+    uint8_t *digits;             // ncodes * seqlen colour digits, NULL if not enumerated
+    uint8_t *fbTable;            // ncodes * ncodes feedback ids, NULL if too large
+    struct mmIndex *index;       // for mmFilter without a feedback table, NULL if too large (see mm-index.c)
+    struct mmMultiset *multiset; // for mmFilter on mid-sized sets, NULL along with the index
+};
+
+/* set up @cfg@ for @colors@ colours and sequences of length @seqlen@; returns 0 on success */
+int mmConfigInit(struct mmConfig *cfg, int colors, int seqlen);
+void mmConfigFree(struct mmConfig *cfg);
+
+/* feedback id of two codes given as digit arrays */
+int mmScoreDigits(const struct mmConfig *cfg, const uint8_t *a, const uint8_t *b);
+
+/* feedback ids of @guess@ against @n@ codes stored one after the other in @codes@ */
+void mmScoreBatch(const struct mmConfig *cfg, const uint8_t *guess, const uint8_t *codes, int n, uint8_t *out);
+
+/* feedback id of two enumerated codes */
+static inline int mmFeedback(const struct mmConfig *cfg, int a, int b)
+{
+    if (cfg->fbTable)
+        return cfg->fbTable[(long)a * cfg->ncodes + b];
+    return mmScoreDigits(cfg, cfg->digits + (long)a * cfg->seqlen, cfg->digits + (long)b * cfg->seqlen);
+}
+
+static inline int mmFbId(const struct mmConfig *cfg, int exact, int approx)
+{
+    return exact * (cfg->seqlen + 1) + approx;
+}
+
+static inline int mmFbExact(const struct mmConfig *cfg, int fb)
+{
+    return fb / (cfg->seqlen + 1);
+}
+
+static inline int mmFbApprox(const struct mmConfig *cfg, int fb)
+{
+    return fb % (cfg->seqlen + 1);
+}
+
+/* convert between code indices and the game's sequences of colours 1..colors */
+void mmCodeToSeq(const struct mmConfig *cfg, int code, int *seq);
+int mmSeqToCode(const struct mmConfig *cfg, const int *seq);
+/* index of a code given as 0-based digits */
+int mmDigitsToCode(const struct mmConfig *cfg, const uint8_t *digits);
+
+/* ======================================================= */
+/* SECTION: random numbers                                 */
+/* ------------------------------------------------------- */
+
+// xoshiro256** generator (see mm-rng.c); one per thread, as it is not locked
+struct mmRng
+{
+    uint64_t s[4];
+};
+
+/* set up @r@ from any 64-bit @seed@ */
+void mmRngSeed(struct mmRng *r, uint64_t seed);
+/* advance @r@ by 2^128 numbers: each jump of a copy gives a stream that never meets the others */
+void mmRngJump(struct mmRng *r);
+
+static inline uint64_t mmRngRotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t mmRngNext(struct mmRng *r)
+{
+    uint64_t *s = r->s, x = mmRngRotl(s[1] * 5, 7) * 9, t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = mmRngRotl(s[3], 45);
+    return x;
+}
+
+/* a number in [0, @n@), @n@ > 0, with no bias: the high word of a 32x32-bit product, redrawn in
+   the rare case that it falls in the uneven part (Lemire), so the usual case has no division */
+static inline uint32_t mmRngBelow(struct mmRng *r, uint32_t n)
+{
+    uint64_t m = (mmRngNext(r) >> 32) * n;
+
+    if ((uint32_t)m < n)
+    {
+        uint32_t floor = (0u - n) % n;
+        while ((uint32_t)m < floor)
+            m = (mmRngNext(r) >> 32) * n;
+    }
+    return m >> 32;
+}
+
+/* a random code as 0-based digits; with @noRepeat@, no colour occurs twice (seqlen <= colors) */
+void mmRngDigits(struct mmRng *r, const struct mmConfig *cfg, int noRepeat, uint8_t *digits);
+
+struct mmPool;
+
+/* @n@ random code indices of @cfg@ into @codes@, in parallel on @pool@; each chunk draws from its
+   own jump of the generator of @seed@, so the codes only depend on the seed; returns 0 on success */
+int mmRngCodes(const struct mmConfig *cfg, struct mmPool *pool, uint64_t seed, uint32_t *codes, long n);
+
+/* ======================================================= */
+/* SECTION: candidate sets and guess selection             */
+/* ------------------------------------------------------- */
+
+/* fill @set@ with all codes; returns the number of codes */
+int mmAllCodes(const struct mmConfig *cfg, int *set);
+
+/* keep only the codes in @set@ that answer @fb@ to @guess@, in their order; returns the new size */
+int mmFilter(const struct mmConfig *cfg, int *set, int n, int guess, int fb);
+
+/* count how many codes of @set@ land in each feedback class of @guess@ */
+void mmPartitionCounts(const struct mmConfig *cfg, int guess, const int *set, int n, int *counts);
+
+/* split @set@ into contiguous classes by feedback to @guess@, written to @out@ (n ints,
+   not @set@) in the order of @set@; class f is out[offs[f]] .. out[offs[f+1]-1], so @offs@
+   has nfb+1 entries; @fbs@ is n bytes of scratch */
+void mmPartition(const struct mmConfig *cfg, int guess, const int *set, int n, int *out, int *offs, uint8_t *fbs);
+
+struct mmGuessScore
+{
+    int worst;      // size of the largest partition
+    int parts;      // number of non-empty partitions
+    double entropy; // partition entropy in bits
+    int inSet;      // the guess is itself a candidate
+};
+
+void mmScoreGuess(const struct mmConfig *cfg, int guess, const int *set, int n, struct mmGuessScore *sc);
+
+/* returns >0 if @a@ is a better guess than @b@ under @mode@ */
+int mmGuessBetter(int mode, const struct mmGuessScore *a, const struct mmGuessScore *b);
+
+/* pick the best of @ng@ @guesses@ against the candidate @set@; @guesses@ NULL means all codes */
+int mmSelectGuess(const struct mmConfig *cfg, int mode, const int *set, int n,
+                  const int *guesses, int ng, struct mmGuessScore *best);
+
+struct mmSymmetry;
+
+// how far an anytime guess selection got before its deadline
+struct mmAnytimeStats
+{
+    int covered;   // guesses scored
+    int total;     // guesses that would be scored without a deadline, 0 if not known by then
+    uint64_t usec; // time spent
+};
+
+/* pick a guess within @budget@ microseconds (0: no deadline), scoring all the candidates
+   first, and then one guess per class of @sym@ (all codes if NULL), keeping the best so far;
+   a guess is not started if it would end after the deadline, so @best@ is left alone, and
+   set[0] returned, if not even one guess fits */
+int mmSelectGuessAnytime(const struct mmConfig *cfg, int mode, const int *set, int n,
+                         const struct mmSymmetry *sym, uint64_t budget,
+                         struct mmGuessScore *best, struct mmAnytimeStats *st);
+
+/* ======================================================= */
+/* SECTION: filtering indexes                              */
+/* ------------------------------------------------------- */
+
+// bitsets over the enumerated code space (see mm-index.c); a candidate set can be a
+// bitset of @words@ words too, code c being bit c % 64 of word c / 64
+struct mmIndex
+{
+    const struct mmConfig *cfg;
+    int words; // 64-bit words per bitset
+    int nsets; // bitsets, interleaved word by word
+    uint64_t *bits;
+};
+
+int mmIndexInit(const struct mmConfig *cfg, struct mmIndex *ix);
+void mmIndexFree(struct mmIndex *ix);
+size_t mmIndexBytes(const struct mmIndex *ix);
+
+/* the bitset of all codes */
+void mmIndexAll(const struct mmIndex *ix, uint64_t *cand);
+/* keep only the codes of the bitset @cand@ that answer @fb@ to @guess@; returns the new size */
+int mmIndexFilter(const struct mmIndex *ix, uint64_t *cand, int guess, int fb);
+/* same as mmFilter, without rescoring the codes; fastest on a @set@ in increasing order */
+int mmIndexFilterSet(const struct mmIndex *ix, int *set, int n, int guess, int fb);
+
+/* make the index and multiset groups of @cfg@, which mmFilter then uses on big sets, if it has
+   no feedback table and the index takes at most MM_MAX_INDEX bytes; returns -1 if it has none,
+   which is no error */
+int mmIndexAttach(struct mmConfig *cfg);
+void mmIndexDetach(struct mmConfig *cfg);
+
+// the enumerated codes grouped by colour multiset, which fixes the colours in common
+// with any guess; only the codes of the groups that agree are checked further
+struct mmMultiset
+{
+    const struct mmConfig *cfg;
+    int ngroups;
+    int *group;      // group of each code
+    int *start;      // ngroups+1 offsets into @members@
+    int *members;    // codes by group, in increasing order within a group
+    uint8_t *counts; // ngroups * colors occurrences of each colour
+};
+
+int mmMultisetInit(const struct mmConfig *cfg, struct mmMultiset *ms);
+void mmMultisetFree(struct mmMultiset *ms);
+/* same as mmFilter; returns -1, with @set@ as it was, if there is no memory */
+int mmMultisetFilter(const struct mmMultiset *ms, int *set, int n, int guess, int fb);
+
+/* ======================================================= */
+/* SECTION: partition-histogram kernels                    */
+/* ------------------------------------------------------- */
+
+#define MM_HIST_SCALAR 0 // reference, one code at a time into one histogram
+#define MM_HIST_LANES 1  // plain C, into per-lane sub-histograms
+#define MM_HIST_SIMD 2   // SSE2 or NEON where available, otherwise MM_HIST_LANES
+
+/* count how many of the @n@ codes stored one after the other in @codes@ land in each
+   feedback class of @guess@, using @kernel@; fewer than 32 codes, as in the game's 3x3,
+   are always counted by the scalar kernel, which is the fastest on them */
+void mmHistogram(const struct mmConfig *cfg, int kernel, const uint8_t *guess, const uint8_t *codes, int n,
+                 int *counts);
+/* instruction set of MM_HIST_SIMD: "sse2", "neon" or "none" */
+const char *mmHistogramSimd(void);
+
+/* ======================================================= */
+/* SECTION: no-repetition variant                          */
+/* ------------------------------------------------------- */
+
+// a code as its digits packed 4 bits each (the first position highest) and its colour mask;
+// the scoring below holds when at least one of the two codes has no repeated colour
+struct mmUnique
+{
+    uint64_t digits;
+    uint32_t mask;
+};
+
+/* number of set bits of a 16-bit value, without a library call where the CPU has no popcount */
+static inline int mmPopcount16(uint32_t v)
+{
+    v = v - ((v >> 1) & 0x5555);
+    v = (v & 0x3333) + ((v >> 2) & 0x3333);
+    v = (v + (v >> 4)) & 0x0f0f;
+    return (v + (v >> 8)) & 0x1f;
+}
+
+static inline struct mmUnique mmUniquePack(const struct mmConfig *cfg, const uint8_t *digits)
+{
+    struct mmUnique u = {0, 0};
+    for (int j = 0; j < cfg->seqlen; j++)
+    {
+        u.digits = (u.digits << 4) | digits[j];
+        u.mask |= 1u << digits[j];
+    }
+    return u;
+}
+
+/* feedback id of two codes, one of them without a repeated colour */
+static inline int mmUniqueScore(const struct mmConfig *cfg, struct mmUnique a, struct mmUnique b)
+{
+    // a nibble of the XOR is zero where the codes agree; fold each into its low bit
+    uint64_t x = a.digits ^ b.digits;
+    x |= x >> 2;
+    x |= x >> 1;
+    x &= 0x1111111111111111ULL;
+    // and add up the bits, two nibbles per byte, over the bytes
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    int exact = cfg->seqlen - (int)((x * 0x0101010101010101ULL) >> 56);
+    return mmFbId(cfg, exact, mmPopcount16(a.mask & b.mask) - exact);
+}
+
+/* number of codes without a repeated colour, colors! / (colors - seqlen)! */
+long mmUniqueCount(const struct mmConfig *cfg);
+/* all codes without a repeated colour, in increasing order; returns their number */
+long mmUniqueAll(const struct mmConfig *cfg, struct mmUnique *codes);
+/* the enumerated codes without a repeated colour, as indices; returns their number */
+int mmUniqueCodes(const struct mmConfig *cfg, int *set);
+/* same as mmHistogram, for @n@ codes without a repeated colour */
+void mmUniqueHistogram(const struct mmConfig *cfg, const struct mmUnique *guess, const struct mmUnique *codes,
+                       long n, int *counts);
+/* keep only the codes that answer @fb@ to @guess@; returns the new number */
+long mmUniqueFilter(const struct mmConfig *cfg, struct mmUnique *codes, long n, const struct mmUnique *guess, int fb);
+
+/* ======================================================= */
+/* SECTION: sampled guess selection                        */
+/* ------------------------------------------------------- */
+
+// the partition of a candidate set by a guess, estimated from a sample;
+// the bounds are about 99% confidence intervals, exact once the sample is the whole set
+struct mmEstimate
+{
+    int samples;
+    double worst, worstLo, worstHi;       // size of the largest class, scaled to the set
+    double entropy, entropyLo, entropyHi; // partition entropy in bits
+    int parts, partsHi;                   // classes seen, and an upper estimate
+};
+
+struct mmSampleStats
+{
+    int rounds;    // times the sample was grown
+    int samples;   // final sample size
+    int left;      // guesses still in the race at the end
+    long scored;   // feedback computations
+    uint64_t usec;
+};
+
+/* estimate the partition of a set of @n@ codes by @guess@ from @m@ codes @sample@d from it */
+void mmEstimateGuess(const struct mmConfig *cfg, int guess, const int *sample, int m, int n,
+                     struct mmEstimate *est);
+
+/* like mmSelectGuess, but on random samples of @set@ (drawn by @seed@) that double until the
+   best guess is statistically separated from the others, or reach @maxSamples@ (0: all of @set@);
+   returns -1 if @set@ is empty or it is out of memory */
+int mmSelectGuessSampled(const struct mmConfig *cfg, int mode, const int *set, int n,
+                         const int *guesses, int ng, int maxSamples, uint64_t seed,
+                         struct mmEstimate *best, struct mmSampleStats *st);
+
+/* ======================================================= */
+/* SECTION: symmetry reduction                             */
+/* ------------------------------------------------------- */
+
+// position permutations are only used up to this sequence length (8! of them)
+#define MM_SYM_MAX_SEQL 8
+
+// the (position permutation, colour renaming) pairs that leave a history unchanged
+struct mmSymmetry
+{
+    int seqlen, colors;
+    int nelem;
+    uint8_t *pos;  // nelem * seqlen: position j of the image is position pos[j] of the code
+    int8_t *col;   // nelem * colors: renaming of the colours played so far, -1 if free
+    uint32_t used; // colours played so far
+};
+
+/* symmetries of the empty history */
+int mmSymInit(const struct mmConfig *cfg, struct mmSymmetry *sym);
+/* symmetries left after @guess@ is added to the history of @parent@ */
+int mmSymRestrict(const struct mmConfig *cfg, const struct mmSymmetry *parent, int guess,
+                  struct mmSymmetry *child);
+void mmSymFree(struct mmSymmetry *sym);
+
+/* smallest code equivalent to @code@ */
+int mmSymCanonical(const struct mmConfig *cfg, const struct mmSymmetry *sym, int code);
+/* one representative (the smallest code) of each class of equivalent guesses; returns their number */
+int mmSymClasses(const struct mmConfig *cfg, const struct mmSymmetry *sym, int *reps);
+
+/* only the identity is left, so there is nothing to reduce */
+static inline int mmSymTrivial(const struct mmConfig *cfg, const struct mmSymmetry *sym)
+{
+    return sym->nelem == 1 && cfg->colors - __builtin_popcount(sym->used) <= 1;
+}
+
+/* ======================================================= */
+/* SECTION: constraint propagation                         */
+/* ------------------------------------------------------- */
+
+struct mmCspGuess
+{
+    uint8_t code[MM_MAX_SEQL];
+    uint8_t count[MM_MAX_COLS]; // occurrences of each colour in @code@
+    int exact, approx;
+};
+
+// the codes consistent with a history, as domains instead of a list;
+// needs only colors and seqlen from the configuration, not its tables
+struct mmCsp
+{
+    int colors, seqlen;
+    uint32_t dom[MM_MAX_SEQL];             // colours still possible at each position
+    int lo[MM_MAX_COLS], hi[MM_MAX_COLS];  // bounds on the occurrences of each colour
+    uint8_t order[MM_MAX_SEQL][MM_MAX_COLS]; // order in which the search tries colours
+    struct mmCspGuess *hist;
+    int nhist, cap;
+    int failed; // an answer left no code consistent
+};
+
+void mmCspInit(struct mmCsp *csp, const struct mmConfig *cfg);
+void mmCspFree(struct mmCsp *csp);
+/* try the colours in a random order (by @seed@), so generated codes are not all alike */
+void mmCspShuffle(struct mmCsp *csp, uint64_t seed);
+/* add the answer to @guess@ and propagate it; returns -1 if no code is consistent any more,
+   or the history cannot grow */
+int mmCspAdd(struct mmCsp *csp, const uint8_t *guess, int exact, int approx);
+/* call @visit@ on consistent codes until it returns non-zero, or @limit@ (0: no limit) codes
+   are found; returns the number found, and the number of search nodes in @nodes@, or -1 if
+   it is out of memory */
+long mmCspSearch(const struct mmCsp *csp, long limit, int (*visit)(void *ctx, const uint8_t *code),
+                 void *ctx, long *nodes);
+/* first consistent code; returns 0 if there is one */
+int mmCspFirst(const struct mmCsp *csp, uint8_t *code, long *nodes);
+
+/* ======================================================= */
+/* SECTION: genetic algorithm                              */
+/* ------------------------------------------------------- */
+
+struct mmGaParams
+{
+    int popSize;     // codes per generation
+    int maxGen;      // generations per move; 0 means no limit
+    int maxEligible; // stop once this many consistent codes are found
+    uint64_t budget; // time per move in microseconds; 0 means no limit
+    uint64_t seed;   // the result only depends on the seed, unless the budget runs out
+};
+
+struct mmGaStats
+{
+    long generations;
+    long evaluated; // fitness evaluations
+    int eligible;   // consistent codes found
+    uint64_t usec;
+};
+
+struct mmPool;
+
+/* evolve codes against the history of @csp@ and put the best consistent one found into
+   @guess@; returns 0 if one was found, 1 if @guess@ is only the fittest code (a random one
+   if there is no memory), or -1, with no guess, if the history leaves no code consistent.
+   Whatever the limits, the search ends once generations stop finding new consistent codes */
+int mmGaGuess(const struct mmConfig *cfg, struct mmPool *pool, const struct mmCsp *csp,
+              const struct mmGaParams *prm, uint8_t *guess, struct mmGaStats *st);
+
+/* ======================================================= */
+/* SECTION: work pool                                      */
+/* ------------------------------------------------------- */
+
+struct mmPool;
+
+/* create a pool of @nthreads@ workers (including the caller); 0 means one per CPU; it has
+   fewer if they cannot all be started, and is NULL, which runs on the caller alone, if out of memory */
+struct mmPool *mmPoolCreate(int nthreads);
+int mmPoolSize(const struct mmPool *pool);
+/* run fn(ctx, i, worker) for all i in [0, n) on the pool, and wait for completion */
+void mmPoolFor(struct mmPool *pool, int n, void (*fn)(void *ctx, int i, int worker), void *ctx);
+void mmPoolDestroy(struct mmPool *pool);
+
+/* ======================================================= */
+/* SECTION: out-of-core candidate sets                     */
+/* ------------------------------------------------------- */
+
+// a candidate set kept on disk as compressed chunks of codes in increasing order (see
+// mm-stream.c); codes are digit arrays, so it works for spaces too large to enumerate
+struct mmStream;
+
+struct mmStreamStats
+{
+    long chunks;        // chunks of the current set
+    long bytes;         // size of the current set on disk
+    long passes;        // passes over the file
+    long bytesRead, bytesWritten;
+    uint64_t ioWait;    // time spent waiting for a chunk to be read
+    size_t resident;    // memory held for chunks and buffers
+};
+
+/* an empty set in temporary files under @dir@ (/tmp if NULL), holding at most about
+   @memCap@ bytes in memory; returns NULL on failure */
+struct mmStream *mmStreamCreate(const struct mmConfig *cfg, const char *dir, size_t memCap);
+void mmStreamDestroy(struct mmStream *s);
+long mmStreamSize(const struct mmStream *s);
+/* make the set all codes; returns their number, or -1 on an I/O error */
+long mmStreamAll(struct mmStream *s);
+/* keep only the codes that answer @fb@ to @guess@; returns the new size, or -1 */
+long mmStreamFilter(struct mmStream *s, const uint8_t *guess, int fb);
+/* count the codes in each feedback class of @guess@, into nfb longs; returns -1 on an error */
+int mmStreamCounts(struct mmStream *s, const uint8_t *guess, long *counts);
+/* like mmSelectGuess, for @ng@ @guesses@ stored one after the other, in one pass with the
+   guesses spread over @pool@; returns the index of the best guess, or -1 */
+int mmStreamSelect(struct mmStream *s, struct mmPool *pool, int mode, const uint8_t *guesses, int ng,
+                   struct mmGuessScore *best);
+/* copy up to @max@ codes of the set, in increasing order, into @codes@; returns their number */
+long mmStreamRead(struct mmStream *s, uint8_t *codes, long max);
+void mmStreamStats(const struct mmStream *s, struct mmStreamStats *st);
+
+/* ======================================================= */
+/* SECTION: fingerprints and memo store                    */
+/* ------------------------------------------------------- */
+
+// 128-bit fingerprint of a set of codes: the XOR of a fixed random value per member,
+// so it can be updated one code at a time, and is the same from one run to the next
+struct mmFp
+{
+    uint64_t lo, hi;
+};
+
+static inline uint64_t mmSplitMix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static inline struct mmFp mmFpCode(int code)
+{
+    struct mmFp fp = {mmSplitMix(2 * (uint64_t)code), mmSplitMix(2 * (uint64_t)code + 1)};
+    return fp;
+}
+
+static inline void mmFpXor(struct mmFp *fp, struct mmFp other)
+{
+    fp->lo ^= other.lo;
+    fp->hi ^= other.hi;
+}
+
+struct mmFp mmFpSet(const int *set, int n);
+
+struct mmMemo;
+
+struct mmMemoStats
+{
+    long loaded;  // entries found in the file when it was opened
+    long spilled; // entries moved from memory to the file
+};
+
+/* a store of subset values for @objective@ on @cfg@, kept in the file @path@ between
+   runs, or only in memory if @path@ is NULL; returns NULL on failure */
+struct mmMemo *mmMemoOpen(const char *path, const struct mmConfig *cfg, int objective);
+/* look up the subset @fp@; returns 1 and fills the out-parameters if it is known */
+int mmMemoGet(struct mmMemo *memo, struct mmFp fp, int *value, int *exact, int *guess);
+/* record the value of the subset @fp@ of @n@ codes, exact or a lower bound */
+void mmMemoPut(struct mmMemo *memo, struct mmFp fp, int n, int value, int exact, int guess);
+void mmMemoStats(const struct mmMemo *memo, struct mmMemoStats *st);
+/* write everything to the file, if any, and free the store */
+void mmMemoClose(struct mmMemo *memo);
+
+/* ======================================================= */
+/* SECTION: optimal decision tree                          */
+/* ------------------------------------------------------- */
+
+// a strategy as a tree: node 0 is the first guess, and the answer to a
+// node's guess selects the next node in O(1)
+struct mmTree
+{
+    int nfb;
+    int nnodes, cap;
+    int *guess; // guess played at each node
+    int *next;  // nnodes * nfb child node ids, -1 if the answer cannot occur
+    long total; // sum of guesses over all secrets
+    int depth;  // worst-case number of guesses
+};
+
+struct mmTreeStats
+{
+    long nodes;    // subsets searched
+    long memoHits; // subsets answered from the memo table
+    long pruned;   // guesses cut off by the bound
+    uint64_t usec; // wall-clock time of the search
+};
+
+/* compute a strategy that is optimal under @objective@ (MM_EXPECTED or MM_WORST), reusing
+   and adding to the values in @memo@ (opened for the same objective), or in a private store if NULL;
+   returns -1 if it runs out of memory */
+int mmTreeSolve(const struct mmConfig *cfg, struct mmPool *pool, int objective, struct mmMemo *memo,
+                struct mmTree *tree, struct mmTreeStats *st);
+void mmTreeFree(struct mmTree *tree);
+
+static inline int mmTreeGuess(const struct mmTree *tree, int node)
+{
+    return tree->guess[node];
+}
+
+static inline int mmTreeNext(const struct mmTree *tree, int node, int fb)
+{
+    return tree->next[node * tree->nfb + fb];
+}
+
+/* ======================================================= */
+/* SECTION: static solver                                  */
+/* ------------------------------------------------------- */
+
+struct mmStaticStats
+{
+    long nodes;     // partial sets of guesses searched
+    long evaluated; // guesses scored
+    int minimal;    // no smaller set exists (the search was not cut by a width)
+    uint64_t usec;
+};
+
+/* find a smallest set of guesses, at most @maxGuesses@, whose answers tell all codes apart,
+   trying the @width@ best guesses at each step (0: all of them, which keeps them all at each of
+   the @maxGuesses@ levels); returns the number of guesses put into @guesses@, or -1 if none was
+   found or it is out of memory */
+int mmStaticSolve(const struct mmConfig *cfg, struct mmPool *pool, int maxGuesses, int width, int *guesses,
+                  struct mmStaticStats *st);
+
+/* ======================================================= */
+/* SECTION: adversarial codemaker                          */
+/* ------------------------------------------------------- */
+
+// a codemaker that picks its answers, not its secret (see mm-adversary.c)
+struct mmAdversary
+{
+    const struct mmConfig *cfg;
+    int *set, n;     // the secrets consistent with all answers so far
+    int *buf;        // scratch for the partition
+    uint8_t *fbs;
+    uint64_t budget; // time for breaking ties, per answer in microseconds; 0 means no limit
+    int ties;        // classes tied for the largest at the last answer
+    uint64_t usec;   // time taken by the last answer
+};
+
+/* start from the @n@ secrets of @set@, or all codes if NULL */
+int mmAdversaryInit(struct mmAdversary *adv, const struct mmConfig *cfg, const int *set, int n, uint64_t budget);
+void mmAdversaryFree(struct mmAdversary *adv);
+/* answer @guess@ with the class that keeps the most secrets; returns its feedback id, or -1 if no secret is left */
+int mmAdversaryAnswer(struct mmAdversary *adv, int guess);
+
+/* ======================================================= */
+/* SECTION: game event log                                 */
+/* ------------------------------------------------------- */
+
+// records of a new log, if no other capacity is given
+#define MM_LOG_CAPACITY (1 << 20)
+// attempts counted apart in a scan; longer games are counted in the last one
+#define MM_LOG_ATTEMPTS 16
+
+// what a record is
+#define MM_LOG_GUESS 1 // a guess answered, the game goes on
+#define MM_LOG_WON 2   // the winning guess
+#define MM_LOG_LOST 3  // the last guess of a game lost
+
+// one answered guess, 32 bytes
+struct mmLogRecord
+{
+    uint64_t usec;       // when it was answered (timeInMicroseconds)
+    uint32_t game;       // game number in the log
+    int32_t secret;      // code index, or -1 if the codes are too many to index
+    int32_t guess;       // code index, or -1 if it has a blank peg
+    uint8_t type;        // MM_LOG_*; 0 while the record is being written
+    uint8_t attempt;     // 1 for the first guess of a game
+    uint8_t exact, approx;
+    uint32_t thinkUsec;  // from the last answer, or the start of the game, to this guess
+    uint32_t answerUsec; // scoring it
+};
+
+struct mmLog;
+
+/* open the log in the file @path@ to append to it, or make it with room for @capacity@ records
+   of @cfg@ (0: MM_LOG_CAPACITY) if the file is new or empty; returns NULL if the file is a
+   log of another configuration, or cannot be set up */
+struct mmLog *mmLogOpen(const char *path, const struct mmConfig *cfg, long capacity);
+/* a new game number */
+uint32_t mmLogGame(struct mmLog *log);
+/* append @r@; returns -1 if the log is full, and the record is dropped */
+int mmLogAppend(struct mmLog *log, const struct mmLogRecord *r);
+void mmLogClose(struct mmLog *log);
+
+// a log mapped read-only, to scan it
+struct mmLogView
+{
+    int colors, seqlen;
+    long capacity;
+    long count;   // records appended, at most the capacity
+    long dropped; // records that did not fit
+    const struct mmLogRecord *records;
+    void *map;
+    size_t mapBytes;
+};
+
+struct mmLogStats
+{
+    long records;
+    long unfinished; // records still being written
+    long games;      // games over: won or lost
+    long won, lost;
+    long attempts[MM_LOG_ATTEMPTS + 1]; // games won in so many attempts
+    uint64_t thinkUsec, answerUsec;     // over all records
+    uint32_t maxAnswerUsec;
+    uint64_t firstUsec, lastUsec; // of the records, 0 if none
+};
+
+/* map the log in the file @fd@, which may be closed afterwards; returns 0 on success */
+int mmLogMap(struct mmLogView *v, int fd);
+void mmLogUnmap(struct mmLogView *v);
+/* totals of all the records of @v@ */
+void mmLogScan(const struct mmLogView *v, struct mmLogStats *st);
+
+/* ======================================================= */
+/* SECTION: game engine                                    */
+/* ------------------------------------------------------- */
+
+// game variants, or'ed together
+#define MM_GAME_NOREPEAT 1  // no colour occurs twice in the secret (Bulls & Cows)
+#define MM_GAME_ADVERSARY 2 // the secret is not fixed, but follows the answers (see mm-adversary.c)
+
+// states of a game
+#define MM_GAME_PLAYING 0
+#define MM_GAME_WON 1
+#define MM_GAME_LOST 2
+
+// time the adversarial codemaker may take for an answer, in microseconds
+#define MM_GAME_BUDGET 50000
+
+// one game, with no I/O (see mm-game.c)
+struct mmGame
+{
+    const struct mmConfig *cfg;
+    int flags;
+    int maxAttempts;             // 0 means no limit
+    int attempts;                // guesses made so far
+    int state;
+    int lastFb;                  // feedback id of the last guess, -1 before the first
+    uint8_t secret[MM_MAX_SEQL]; // with an adversary, a secret consistent with all answers so far
+    struct mmRng rng;
+    struct mmAdversary adv;      // with MM_GAME_ADVERSARY, until the secret is fixed
+    struct mmLog *log;           // where each answer is logged, if any
+    uint32_t logGame;            // game number in the log
+    uint64_t logUsec;            // time of the last answer, or of the start of the game
+};
+
+/* start a game with a random secret drawn from @seed@; returns 0 on success */
+int mmGameInit(struct mmGame *g, const struct mmConfig *cfg, int flags, int maxAttempts, uint64_t seed);
+void mmGameFree(struct mmGame *g);
+/* start the next game, with the next random secret */
+int mmGameRestart(struct mmGame *g);
+/* replace the secret before the first guess; returns -1 if it is not valid for the game,
+   or with MM_GAME_ADVERSARY, whose secret follows the answers */
+int mmGameSetSecret(struct mmGame *g, const uint8_t *secret);
+/* answer @guess@, 0-based colours with any colour out of range as a blank peg;
+   returns its feedback id, or -1 once the game is over */
+int mmGameGuess(struct mmGame *g, const uint8_t *guess);
+/* state of a game (MM_GAME_*) once its @attempts@-th answer is @fb@; the rule of the
+   engine, shared with the game sessions */
+int mmGameOutcome(const struct mmConfig *cfg, int fb, int attempts, int maxAttempts);
+/* log every answer from now on to @log@ (NULL to stop), with the time taken */
+void mmGameSetLog(struct mmGame *g, struct mmLog *log);
+
+/* ======================================================= */
+/* SECTION: game sessions                                  */
+/* ------------------------------------------------------- */
+
+// guesses a session keeps, and so the most attempts in one
+#define MM_SESSION_HISTORY 8
+// largest code space for sessions, whose guesses are 16-bit code indices
+#define MM_SESSION_MAX_CODES 65536
+
+// states of a session
+#define MM_SESSION_NEW 0   // no secret drawn yet
+#define MM_SESSION_GUESS 1 // waiting for a guess
+#define MM_SESSION_WON 2
+#define MM_SESSION_LOST 3
+
+// one game as a resumable state machine (see mm-session.c)
+struct mmSession
+{
+    int32_t secret;
+    uint16_t guesses[MM_SESSION_HISTORY];
+    uint8_t fbs[MM_SESSION_HISTORY];
+    uint8_t attempts;
+    uint8_t state;
+};
+
+/* draw a secret from @rng@ and wait for the first guess */
+void mmSessionStart(const struct mmConfig *cfg, struct mmSession *s, struct mmRng *rng);
+/* answer @guess@ (a code index); returns its feedback id, or -1 if the session is not waiting for one */
+int mmSessionAnswer(const struct mmConfig *cfg, struct mmSession *s, int guess, int maxAttempts);
+
+// many sessions played by the built-in player, round robin on one thread
+struct mmSessionSet
+{
+    const struct mmConfig *cfg;
+    struct mmSession *sessions;
+    long n;
+    int maxAttempts;
+    struct mmRng rng;
+    long steps, won, lost, guesses; // guesses over all games won
+};
+
+int mmSessionsInit(struct mmSessionSet *ss, const struct mmConfig *cfg, long n, int maxAttempts, uint64_t seed);
+void mmSessionsFree(struct mmSessionSet *ss);
+/* move @s@ by one transition; returns its new state; a session over is counted and started again */
+int mmSessionStep(struct mmSessionSet *ss, struct mmSession *s);
+/* make @steps@ steps, one session after the other; returns the number of steps made */
+long mmSessionsRun(struct mmSessionSet *ss, long steps);
+
+/* ======================================================= */
+/* SECTION: strategies and tournaments                     */
+/* ------------------------------------------------------- */
+
+// a guessing strategy (see mm-strategy.c); a plugin exports one as `struct mmStrategy mmStrategyPlugin`
+struct mmStrategy
+{
+    const char *name;
+    // state shared by all games of @cfg@, read-only once made; NULL on failure
+    void *(*init)(const struct mmConfig *cfg, struct mmPool *pool);
+    void (*destroy)(void *shared);
+    // state of one game; games of one shared state may be played at the same time
+    void *(*start)(void *shared);
+    void (*end)(void *game);
+    // the next guess as a code index, -1 to give up
+    int (*next)(void *game);
+    // the feedback id @fb@ given to @guess@
+    void (*observe)(void *game, int guess, int fb);
+};
+
+/* the @i@-th built-in strategy, NULL past the last one */
+const struct mmStrategy *mmStrategyBuiltin(int i);
+/* the built-in strategy named @name@, or else the plugin at that path */
+const struct mmStrategy *mmStrategyFind(const char *name);
+/* the strategy exported by the shared object at @path@; NULL if it cannot be loaded */
+const struct mmStrategy *mmStrategyLoad(const char *path);
+
+struct mmTournamentStats
+{
+    long games;
+    long guesses;      // over all games won
+    int worst;         // most guesses in a game won
+    long won;          // games won within the attempt limit
+    long failed;       // games never won: the strategy gave up, or guessed no code
+    uint64_t cpuUsec;  // CPU time of all games, without the shared state
+    uint64_t initUsec; // time to make the shared state
+    uint64_t usec;     // wall-clock time, all included
+};
+
+/* play @s@ against every secret of @cfg@, in parallel on @pool@; returns 0 on success */
+int mmTournament(const struct mmConfig *cfg, struct mmPool *pool, const struct mmStrategy *s, int maxAttempts,
+                 struct mmTournamentStats *st);
+/* the same, against the @n@ secrets of @secrets@ only, e.g. the codes of a corpus; a secret that
+   is no code of @cfg@ is counted as failed */
+int mmTournamentSecrets(const struct mmConfig *cfg, struct mmPool *pool, const struct mmStrategy *s, int maxAttempts,
+                        const uint32_t *secrets, long n, struct mmTournamentStats *st);
+
+/* ======================================================= */
+/* SECTION: binary corpora                                 */
+/* ------------------------------------------------------- */
+
+// what the records of a corpus are
+#define MM_CORPUS_CODES 1  // uint32_t code indices
+#define MM_CORPUS_PAIRS 2  // struct mmCorpusPair
+#define MM_CORPUS_SCORED 3 // struct mmCorpusScored
+
+// exact and approximate of a scored pair that are not two codes of the configuration
+#define MM_CORPUS_INVALID 0xff
+
+struct mmCorpusPair
+{
+    uint32_t a, b;
+};
+
+struct mmCorpusScored
+{
+    uint32_t a, b;
+    uint8_t exact, approx;
+    uint8_t pad[2];
+};
+
+// a corpus mapped read-only from its file; @records@ points into the mapping
+struct mmCorpus
+{
+    int kind;
+    int colors, seqlen;
+    long count;
+    const void *records;
+    void *map;
+    size_t mapBytes;
+};
+
+/* map the corpus in the file @fd@, which may be closed afterwards; returns 0 on success, and -1 if
+   the file is not a corpus of this version, or is cut short */
+int mmCorpusMap(struct mmCorpus *c, int fd);
+void mmCorpusUnmap(struct mmCorpus *c);
+/* write @count@ records of @kind@ for @cfg@ to the file @fd@, as a corpus; returns 0 on success */
+int mmCorpusWrite(int fd, const struct mmConfig *cfg, int kind, const void *records, long count);
+
+/* ======================================================= */
+/* SECTION: batch scoring                                  */
+/* ------------------------------------------------------- */
+
+struct mmBatchStats
+{
+    long lines;  // or pairs of a corpus
+    long errors; // lines that are not two codes, answered "ERR"
+    long bytesIn, bytesOut;
+    uint64_t usec;
+};
+
+/* read "code code" lines (colours 1..9, as for -u) from the file descriptor @in@, and write one
+   "exact approximate" line each to @out@, scoring on @threads@ threads (0: one per CPU); needs at
+   most 9 colours and 8 positions, and about 10 MB per thread; returns 0 on success, or -1 if the
+   input cannot be read, the output written, or the memory or threads cannot be had (see mm-batch.c) */
+int mmBatchScore(const struct mmConfig *cfg, int in, int out, int threads, struct mmBatchStats *st);
+/* score the pairs of the corpus @in@, made for @cfg@, into @out@ (@in->count@ records), in
+   parallel on @pool@; a pair that is not two codes of @cfg@ is scored MM_CORPUS_INVALID and
+   counted as an error; returns 0 on success, -1 if @in@ holds no pairs of @cfg@ or out of memory */
+int mmBatchScoreCorpus(const struct mmConfig *cfg, struct mmPool *pool, const struct mmCorpus *in,
+                       struct mmCorpusScored *out, struct mmBatchStats *st);
+
+/* ======================================================= */
+/* SECTION: result output                                  */
+/* ------------------------------------------------------- */
+
+// bytes of output an emitter holds before it writes them
+#define MM_EMIT_BUFSIZE (1 << 16)
+// most bytes of one result
+#define MM_EMIT_MAX_MATCHES 48
+
+// output of results to a file descriptor, in blocks (see mm-emit.c)
+struct mmEmitter
+{
+    int fd;
+    int error; // a write failed; the output since is dropped
+    size_t len;
+    char buf[MM_EMIT_BUFSIZE];
+};
+
+void mmEmitInit(struct mmEmitter *e, int fd);
+/* append a result as showMatches() prints it: "<exact> exact" and "<approx> approximate" lines */
+void mmEmitMatches(struct mmEmitter *e, int exact, int approx);
+/* write all the output so far; returns 0 on success, -1 if any write failed */
+int mmEmitFlush(struct mmEmitter *e);
+
+/* ======================================================= */
+/* SECTION: provided by the game (master-mind.c)           */
+/* ------------------------------------------------------- */
+
+uint64_t timeInMicroseconds();
+
+#endif
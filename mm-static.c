@@ -0,0 +1,303 @@
+/*
+ * Static (non-adaptive) solver: a smallest set of guesses, all played up
+ * front, whose answers together tell every secret apart.
+ *
+ * The search is an iterative deepening over the number of guesses. The
+ * codes are kept as a partition by the answers to the guesses chosen so far,
+ * with the classes of one code dropped as they are solved; a guess is scored
+ * by the pairs of codes it leaves colliding (in one class) and the size of
+ * the largest class, which must be small enough to be split down to single
+ * codes by the guesses left. All guesses are scored on the work pool at
+ * every node, and tried best first. The first guess is only taken from one
+ * code per symmetry class (see mm-symmetry.c); a set of guesses is searched
+ * in one order only, the guesses after the second one in increasing order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+#include "mm-solver.h"
+
+// guesses scored per task on the work pool
+#define STATIC_CHUNK 32
+
+struct staticCand
+{
+    long collisions; // pairs of codes left in a common class; LONG_MAX if out of bounds
+    int worst;       // largest class left
+    int guess;
+};
+
+// the codes not yet told apart, by class
+struct staticLevel
+{
+    int *codes;
+    int *start; // nclasses+1 offsets into @codes@
+    int nclasses;
+};
+
+struct staticSolver
+{
+    const struct mmConfig *cfg;
+    struct mmPool *pool;
+    int width;  // candidates tried per node, 0 for all
+    int depth;  // number of guesses searched for
+    int parts;  // most classes a guess can split a class into
+    struct staticLevel *levels;
+    struct staticCand **cand; // per level: all guesses, or the @width@ best ones
+    struct staticCand *all;   // all guesses, scored at a node when the width is set
+    int *guesses;
+    int *reps, nreps; // first guesses
+    int *tmp;
+    uint8_t *fbs;
+    long nodes, evaluated;
+
+    // the node being scored
+    const struct staticLevel *lv;
+    struct staticCand *scoring;
+    int nscoring;
+    long maxClass;
+};
+
+/* largest class that @r@ more guesses can split down to single codes */
+static long staticCapacity(int parts, int r)
+{
+    long c = 1;
+    while (r-- > 0 && c < INT_MAX)
+        c *= parts;
+    return c;
+}
+
+/* collisions and largest class left after adding @c->guess@ to the level */
+static void staticScore(const struct staticSolver *sv, struct staticCand *c)
+{
+    const struct mmConfig *cfg = sv->cfg;
+    const struct staticLevel *lv = sv->lv;
+    int counts[MM_MAX_FB];
+
+    c->collisions = 0;
+    c->worst = 1;
+    for (int k = 0; k < lv->nclasses; k++)
+    {
+        memset(counts, 0, cfg->nfb * sizeof(int));
+        for (int i = lv->start[k]; i < lv->start[k + 1]; i++)
+            counts[mmFeedback(cfg, c->guess, lv->codes[i])]++;
+        for (int f = 0; f < cfg->nfb; f++)
+        {
+            c->collisions += (long)counts[f] * (counts[f] - 1) / 2;
+            if (counts[f] > c->worst)
+                c->worst = counts[f];
+        }
+        // a class too large for the guesses left cannot be split in time
+        if (c->worst > sv->maxClass)
+        {
+            c->collisions = LONG_MAX;
+            return;
+        }
+    }
+}
+
+static void staticScoreTask(void *ctx, int chunk, int worker)
+{
+    struct staticSolver *sv = (struct staticSolver *)ctx;
+    int end = (chunk + 1) * STATIC_CHUNK < sv->nscoring ? (chunk + 1) * STATIC_CHUNK : sv->nscoring;
+
+    (void)worker;
+    for (int i = chunk * STATIC_CHUNK; i < end; i++)
+        staticScore(sv, &sv->scoring[i]);
+}
+
+static int staticCompare(const void *pa, const void *pb)
+{
+    const struct staticCand *a = (const struct staticCand *)pa, *b = (const struct staticCand *)pb;
+    if (a->collisions != b->collisions)
+        return a->collisions < b->collisions ? -1 : 1;
+    if (a->worst != b->worst)
+        return a->worst - b->worst;
+    return a->guess - b->guess;
+}
+
+/* split the classes of level @d@ by @guess@ into level @d@+1, keeping only classes of two codes or more */
+static void staticRefine(struct staticSolver *sv, int d, int guess)
+{
+    const struct mmConfig *cfg = sv->cfg;
+    const struct staticLevel *lv = &sv->levels[d];
+    struct staticLevel *next = &sv->levels[d + 1];
+    int offs[MM_MAX_FB + 1], n = 0;
+
+    next->nclasses = 0;
+    next->start[0] = 0;
+    for (int k = 0; k < lv->nclasses; k++)
+    {
+        int size = lv->start[k + 1] - lv->start[k];
+        mmPartition(cfg, guess, lv->codes + lv->start[k], size, sv->tmp, offs, sv->fbs);
+        for (int f = 0; f < cfg->nfb; f++)
+        {
+            int m = offs[f + 1] - offs[f];
+            if (m < 2)
+                continue;
+            memcpy(next->codes + n, sv->tmp + offs[f], m * sizeof(int));
+            n += m;
+            next->start[++next->nclasses] = n;
+        }
+    }
+}
+
+/* choose guesses @d@..depth-1; returns 1 once all codes are told apart */
+static int staticSearch(struct staticSolver *sv, int d)
+{
+    const struct mmConfig *cfg = sv->cfg;
+    struct staticCand *cand = sv->width ? sv->all : sv->cand[d];
+    long before = 0;
+    int n = 0, k, g;
+
+    if (sv->levels[d].nclasses == 0)
+        return 1;
+    if (d == sv->depth)
+        return 0;
+    sv->nodes++;
+
+    // the guesses allowed here, so each set of guesses is searched once
+    if (d == 0)
+        for (k = 0; k < sv->nreps; k++)
+            cand[n++].guess = sv->reps[k];
+    else
+        for (g = d == 1 ? 0 : sv->guesses[d - 1] + 1; g < cfg->ncodes; g++)
+            if (g != sv->guesses[0])
+                cand[n++].guess = g;
+
+    sv->lv = &sv->levels[d];
+    sv->scoring = cand;
+    sv->nscoring = n;
+    sv->maxClass = staticCapacity(sv->parts, sv->depth - d - 1);
+    mmPoolFor(sv->pool, (n + STATIC_CHUNK - 1) / STATIC_CHUNK, staticScoreTask, sv);
+    sv->evaluated += n;
+    qsort(cand, n, sizeof(struct staticCand), staticCompare);
+    // only the best ones are tried, so only they are kept for this level
+    if (sv->width)
+    {
+        if (n > sv->width)
+            n = sv->width;
+        memcpy(sv->cand[d], cand, n * sizeof(struct staticCand));
+        cand = sv->cand[d];
+    }
+
+    for (k = 0; k < sv->levels[d].nclasses; k++)
+    {
+        long m = sv->levels[d].start[k + 1] - sv->levels[d].start[k];
+        before += m * (m - 1) / 2;
+    }
+    for (k = 0; k < n && cand[k].collisions < before; k++)
+    {
+        sv->guesses[d] = cand[k].guess;
+        staticRefine(sv, d, cand[k].guess);
+        if (staticSearch(sv, d + 1))
+            return 1;
+    }
+    return 0;
+}
+
+/* free what mmStaticSolve took, whether or not it got all of it */
+static void staticFree(struct staticSolver *sv, int maxGuesses)
+{
+    for (int d = 0; d <= maxGuesses; d++)
+    {
+        if (sv->levels)
+        {
+            free(sv->levels[d].codes);
+            free(sv->levels[d].start);
+        }
+        if (sv->cand && d < maxGuesses)
+            free(sv->cand[d]);
+    }
+    free(sv->levels);
+    free(sv->cand);
+    free(sv->all);
+    free(sv->guesses);
+    free(sv->tmp);
+    free(sv->fbs);
+    free(sv->reps);
+}
+
+int mmStaticSolve(const struct mmConfig *cfg, struct mmPool *pool, int maxGuesses, int width, int *guesses,
+                  struct mmStaticStats *st)
+{
+    struct staticSolver sv;
+    struct mmSymmetry sym;
+    uint64_t t0 = timeInMicroseconds();
+    int d, found = -1, complete = 1, ok;
+
+    if (cfg->ncodes == 0 || maxGuesses < 1)
+        return -1;
+    memset(&sv, 0, sizeof(sv));
+    sv.cfg = cfg;
+    sv.pool = pool;
+    sv.width = width < cfg->ncodes ? width : 0;
+    // all (exact, approx) pairs except (seqlen-1, 1), which cannot occur
+    sv.parts = (cfg->seqlen + 1) * (cfg->seqlen + 2) / 2 - 1;
+    sv.levels = (struct staticLevel *)calloc(maxGuesses + 1, sizeof(struct staticLevel));
+    sv.cand = (struct staticCand **)calloc(maxGuesses, sizeof(struct staticCand *));
+    sv.all = sv.width ? (struct staticCand *)malloc(cfg->ncodes * sizeof(struct staticCand)) : NULL;
+    sv.guesses = (int *)calloc(maxGuesses, sizeof(int));
+    sv.tmp = (int *)malloc(cfg->ncodes * sizeof(int));
+    sv.fbs = (uint8_t *)malloc(cfg->ncodes);
+    sv.reps = (int *)malloc(cfg->ncodes * sizeof(int));
+    ok = sv.levels && sv.cand && (sv.all || !sv.width) && sv.guesses && sv.tmp && sv.fbs && sv.reps;
+    for (d = 0; ok && d <= maxGuesses; d++)
+    {
+        sv.levels[d].codes = (int *)malloc(cfg->ncodes * sizeof(int));
+        sv.levels[d].start = (int *)malloc((cfg->ncodes / 2 + 1) * sizeof(int));
+        ok = sv.levels[d].codes && sv.levels[d].start;
+        if (ok && d < maxGuesses)
+        {
+            sv.cand[d] = (struct staticCand *)malloc((sv.width ? sv.width : cfg->ncodes) * sizeof(struct staticCand));
+            ok = sv.cand[d] != NULL;
+        }
+    }
+    if (!ok)
+    {
+        staticFree(&sv, maxGuesses);
+        if (st)
+            memset(st, 0, sizeof(*st));
+        return -1;
+    }
+    if (mmSymInit(cfg, &sym) == 0)
+    {
+        sv.nreps = mmSymClasses(cfg, &sym, sv.reps);
+        mmSymFree(&sym);
+    }
+    else
+        sv.nreps = mmAllCodes(cfg, sv.reps);
+
+    // level 0: all codes in one class
+    sv.levels[0].nclasses = cfg->ncodes > 1;
+    sv.levels[0].start[0] = 0;
+    sv.levels[0].start[1] = mmAllCodes(cfg, sv.levels[0].codes);
+
+    for (d = 0; d <= maxGuesses && found < 0; d++)
+    {
+        // fewer guesses cannot give every code its own answers
+        if (staticCapacity(sv.parts, d) < cfg->ncodes)
+            continue;
+        sv.depth = d;
+        if (staticSearch(&sv, 0))
+            found = d;
+        else if (sv.width)
+            complete = 0;
+    }
+    if (found >= 0)
+        memcpy(guesses, sv.guesses, found * sizeof(int));
+
+    if (st)
+    {
+        st->nodes = sv.nodes;
+        st->evaluated = sv.evaluated;
+        st->minimal = found >= 0 && complete;
+        st->usec = timeInMicroseconds() - t0;
+    }
+    staticFree(&sv, maxGuesses);
+    return found;
+}
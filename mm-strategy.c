@@ -0,0 +1,392 @@
+/*
+ * Guessing strategies behind one interface, and a tournament that plays a
+ * strategy against every secret of a configuration, or against a list of
+ * secrets such as the codes of a corpus.
+ *
+ * A strategy makes one shared, read-only state per configuration (a first
+ * guess, a decision tree...) and a small state per game, so the games of a
+ * tournament are played in parallel on the work pool, one per task. Besides
+ * the built-ins, a strategy can come from a shared object that exports a
+ * `struct mmStrategy mmStrategyPlugin`; such an object stays loaded until
+ * the program exits.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#include "mm-solver.h"
+
+// games played per task on the work pool
+#define STRATEGY_CHUNK 16
+
+/* ======================================================= */
+/* SECTION: built-in strategies                            */
+/* ------------------------------------------------------- */
+
+// shared by the strategies that keep the codes still possible
+struct strategyShared
+{
+    const struct mmConfig *cfg;
+    int mode;  // guess-selection criterion, or -1 to play the first code possible
+    int first; // first guess, the same in every game
+};
+
+struct strategyGame
+{
+    const struct strategyShared *sh;
+    int n, moves;
+    int set[]; // the codes still possible
+};
+
+static void *strategyInit(const struct mmConfig *cfg, struct mmPool *pool, int mode)
+{
+    struct strategyShared *sh;
+    int *set;
+
+    (void)pool;
+    if (cfg->ncodes == 0 || (sh = (struct strategyShared *)malloc(sizeof(*sh))) == NULL)
+        return NULL;
+    sh->cfg = cfg;
+    sh->mode = mode;
+    sh->first = 0;
+    if (mode >= 0 && (set = (int *)malloc(cfg->ncodes * sizeof(int))) != NULL)
+    {
+        struct mmGuessScore sc;
+        sh->first = mmSelectGuess(cfg, mode, set, mmAllCodes(cfg, set), NULL, 0, &sc);
+        free(set);
+    }
+    return sh;
+}
+
+static void *consistentInit(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    return strategyInit(cfg, pool, -1);
+}
+
+static void *minimaxInit(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    return strategyInit(cfg, pool, MM_MINIMAX);
+}
+
+static void *entropyInit(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    return strategyInit(cfg, pool, MM_ENTROPY);
+}
+
+static void *partsInit(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    return strategyInit(cfg, pool, MM_PARTS);
+}
+
+static void *strategyStart(void *shared)
+{
+    const struct strategyShared *sh = (const struct strategyShared *)shared;
+    struct strategyGame *g = (struct strategyGame *)malloc(sizeof(*g) + sh->cfg->ncodes * sizeof(int));
+
+    if (g == NULL)
+        return NULL;
+    g->sh = sh;
+    g->n = mmAllCodes(sh->cfg, g->set);
+    g->moves = 0;
+    return g;
+}
+
+static int strategyNext(void *game)
+{
+    struct strategyGame *g = (struct strategyGame *)game;
+    const struct strategyShared *sh = g->sh;
+    struct mmGuessScore sc;
+
+    if (sh->mode < 0 || g->n <= 2)
+        return g->set[0];
+    if (g->moves == 0)
+        return sh->first;
+    return mmSelectGuess(sh->cfg, sh->mode, g->set, g->n, NULL, 0, &sc);
+}
+
+static void strategyObserve(void *game, int guess, int fb)
+{
+    struct strategyGame *g = (struct strategyGame *)game;
+
+    g->n = mmFilter(g->sh->cfg, g->set, g->n, guess, fb);
+    g->moves++;
+}
+
+/* the optimal strategy: a walk down the tree, whose state is the node reached */
+static void *optimalInit(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    struct mmTree *tree;
+
+    if (cfg->ncodes == 0 || (tree = (struct mmTree *)malloc(sizeof(*tree))) == NULL)
+        return NULL;
+    if (mmTreeSolve(cfg, pool, MM_EXPECTED, NULL, tree, NULL) != 0)
+    {
+        free(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+static void optimalDestroy(void *shared)
+{
+    mmTreeFree((struct mmTree *)shared);
+    free(shared);
+}
+
+struct optimalGame
+{
+    const struct mmTree *tree;
+    int node;
+};
+
+static void *optimalStart(void *shared)
+{
+    struct optimalGame *g = (struct optimalGame *)malloc(sizeof(*g));
+
+    if (g == NULL)
+        return NULL;
+    g->tree = (const struct mmTree *)shared;
+    g->node = 0;
+    return g;
+}
+
+static int optimalNext(void *game)
+{
+    struct optimalGame *g = (struct optimalGame *)game;
+    return g->node >= 0 ? mmTreeGuess(g->tree, g->node) : -1;
+}
+
+static void optimalObserve(void *game, int guess, int fb)
+{
+    struct optimalGame *g = (struct optimalGame *)game;
+
+    (void)guess;
+    if (g->node >= 0)
+        g->node = mmTreeNext(g->tree, g->node, fb);
+}
+
+/* the genetic algorithm, as it plays codes too large to enumerate; its state is the history */
+static void *geneticInit(const struct mmConfig *cfg, struct mmPool *pool)
+{
+    (void)pool;
+    return cfg->ncodes > 0 ? (void *)cfg : NULL;
+}
+
+static void geneticDestroy(void *shared)
+{
+    (void)shared;
+}
+
+struct geneticGame
+{
+    const struct mmConfig *cfg;
+    struct mmCsp csp;
+    int moves;
+    int lost; // an answer could not be added to the history, or contradicts it
+};
+
+static void *geneticStart(void *shared)
+{
+    struct geneticGame *g = (struct geneticGame *)malloc(sizeof(*g));
+
+    if (g == NULL)
+        return NULL;
+    g->cfg = (const struct mmConfig *)shared;
+    mmCspInit(&g->csp, g->cfg);
+    g->moves = 0;
+    g->lost = 0;
+    return g;
+}
+
+static void geneticEnd(void *game)
+{
+    struct geneticGame *g = (struct geneticGame *)game;
+
+    mmCspFree(&g->csp);
+    free(g);
+}
+
+static int geneticNext(void *game)
+{
+    struct geneticGame *g = (struct geneticGame *)game;
+    // games run in parallel on the pool, so each one evolves on its own thread
+    struct mmGaParams prm = {150, 100, 60, 0, 1701 + g->moves};
+    uint8_t guess[MM_MAX_SEQL];
+
+    if (g->lost || mmGaGuess(g->cfg, NULL, &g->csp, &prm, guess, NULL) < 0)
+        return -1;
+    return mmDigitsToCode(g->cfg, guess);
+}
+
+static void geneticObserve(void *game, int guess, int fb)
+{
+    struct geneticGame *g = (struct geneticGame *)game;
+    const struct mmConfig *cfg = g->cfg;
+
+    if (mmCspAdd(&g->csp, cfg->digits + (long)guess * cfg->seqlen, mmFbExact(cfg, fb), mmFbApprox(cfg, fb)) != 0)
+        g->lost = 1;
+    g->moves++;
+}
+
+static const struct mmStrategy builtins[] = {
+    {"consistent", consistentInit, free, strategyStart, free, strategyNext, strategyObserve},
+    {"minimax", minimaxInit, free, strategyStart, free, strategyNext, strategyObserve},
+    {"entropy", entropyInit, free, strategyStart, free, strategyNext, strategyObserve},
+    {"parts", partsInit, free, strategyStart, free, strategyNext, strategyObserve},
+    {"optimal", optimalInit, optimalDestroy, optimalStart, free, optimalNext, optimalObserve},
+    {"genetic", geneticInit, geneticDestroy, geneticStart, geneticEnd, geneticNext, geneticObserve},
+};
+#define NBUILTINS (sizeof(builtins) / sizeof(builtins[0]))
+
+const struct mmStrategy *mmStrategyBuiltin(int i)
+{
+    return i >= 0 && i < (int)NBUILTINS ? &builtins[i] : NULL;
+}
+
+const struct mmStrategy *mmStrategyFind(const char *name)
+{
+    for (unsigned i = 0; i < NBUILTINS; i++)
+        if (strcmp(builtins[i].name, name) == 0)
+            return &builtins[i];
+    // anything else is the path of a plugin
+    return mmStrategyLoad(name);
+}
+
+const struct mmStrategy *mmStrategyLoad(const char *path)
+{
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    const struct mmStrategy *s;
+
+    if (handle == NULL)
+        return NULL;
+    s = (const struct mmStrategy *)dlsym(handle, "mmStrategyPlugin");
+    if (s == NULL || !s->init || !s->start || !s->next || !s->observe)
+    {
+        dlclose(handle);
+        return NULL;
+    }
+    return s;
+}
+
+/* ======================================================= */
+/* SECTION: tournament                                     */
+/* ------------------------------------------------------- */
+
+struct strategyTournament
+{
+    const struct mmConfig *cfg;
+    const struct mmStrategy *s;
+    void *shared;
+    int maxAttempts;
+    const uint32_t *secrets; // NULL for every code
+    long nsecrets;
+    struct mmTournamentStats *partial; // one per worker, merged at the end
+};
+
+static uint64_t strategyCpuTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* play the secrets of one chunk; a game ends when it is won, or lost if the strategy gives up,
+   guesses an invalid code, or needs more guesses than there are codes; a secret that is no
+   code is not played, and lost */
+static void strategyPlayTask(void *ctx, int chunk, int worker)
+{
+    struct strategyTournament *t = (struct strategyTournament *)ctx;
+    const struct mmConfig *cfg = t->cfg;
+    struct mmTournamentStats *st = &t->partial[worker];
+    long end = (long)(chunk + 1) * STRATEGY_CHUNK < t->nsecrets ? (long)(chunk + 1) * STRATEGY_CHUNK : t->nsecrets;
+    uint64_t t0 = strategyCpuTime();
+
+    for (long i = (long)chunk * STRATEGY_CHUNK; i < end; i++)
+    {
+        int secret = t->secrets ? (int)t->secrets[i] : (int)i;
+        void *game = NULL;
+        int moves = 0, guess, fb = -1;
+
+        if (secret >= 0 && secret < cfg->ncodes)
+            game = t->s->start(t->shared);
+        while (game && moves < cfg->ncodes && fb != cfg->winFb)
+        {
+            guess = t->s->next(game);
+            if (guess < 0 || guess >= cfg->ncodes)
+                break;
+            fb = mmFeedback(cfg, guess, secret);
+            t->s->observe(game, guess, fb);
+            moves++;
+        }
+        if (game && t->s->end)
+            t->s->end(game);
+
+        st->games++;
+        if (fb != cfg->winFb)
+        {
+            st->failed++;
+            continue;
+        }
+        st->guesses += moves;
+        if (moves > st->worst)
+            st->worst = moves;
+        if (moves <= t->maxAttempts)
+            st->won++;
+    }
+    st->cpuUsec += strategyCpuTime() - t0;
+}
+
+int mmTournament(const struct mmConfig *cfg, struct mmPool *pool, const struct mmStrategy *s, int maxAttempts,
+                 struct mmTournamentStats *st)
+{
+    return mmTournamentSecrets(cfg, pool, s, maxAttempts, NULL, cfg->ncodes, st);
+}
+
+int mmTournamentSecrets(const struct mmConfig *cfg, struct mmPool *pool, const struct mmStrategy *s, int maxAttempts,
+                        const uint32_t *secrets, long n, struct mmTournamentStats *st)
+{
+    struct strategyTournament t;
+    int nworkers = mmPoolSize(pool);
+    uint64_t t0 = timeInMicroseconds();
+
+    memset(st, 0, sizeof(*st));
+    if (cfg->ncodes == 0)
+        return -1;
+    t.cfg = cfg;
+    t.s = s;
+    t.maxAttempts = maxAttempts;
+    t.secrets = secrets;
+    t.nsecrets = n;
+    if ((t.shared = s->init(cfg, pool)) == NULL)
+        return -1;
+    st->initUsec = timeInMicroseconds() - t0;
+    t.partial = (struct mmTournamentStats *)calloc(nworkers, sizeof(struct mmTournamentStats));
+    if (t.partial == NULL)
+    {
+        if (s->destroy)
+            s->destroy(t.shared);
+        return -1;
+    }
+
+    mmPoolFor(pool, (int)((n + STRATEGY_CHUNK - 1) / STRATEGY_CHUNK), strategyPlayTask, &t);
+
+    for (int w = 0; w < nworkers; w++)
+    {
+        st->games += t.partial[w].games;
+        st->guesses += t.partial[w].guesses;
+        st->won += t.partial[w].won;
+        st->failed += t.partial[w].failed;
+        st->cpuUsec += t.partial[w].cpuUsec;
+        if (t.partial[w].worst > st->worst)
+            st->worst = t.partial[w].worst;
+    }
+    if (s->destroy)
+        s->destroy(t.shared);
+    free(t.partial);
+    st->usec = timeInMicroseconds() - t0;
+    return 0;
+}
@@ -0,0 +1,571 @@
+/*
+ * Out-of-core candidate sets, for code spaces too large for memory.
+ *
+ * The set is kept in a file as a sequence of chunks. A code is stored as
+ * a key, its digits packed 4 bits each with the first position highest,
+ * so keys sort in code order; a chunk is the varint-coded differences
+ * between consecutive keys, which takes about a byte per code while the
+ * set is dense. Filtering, partition counting and guess scoring are passes
+ * over the file, one chunk at a time: a reader thread loads the next chunk
+ * while the current one is decoded and scored. The size of the chunks and
+ * buffers follows from the memory cap given when the set is created.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include <unistd.h>
+#include <pthread.h>
+
+#include "mm-solver.h"
+
+// longest varint of a 64-bit difference
+#define STREAM_VARINT 10
+// smallest memory cap accepted
+#define STREAM_MIN_CAP 4096
+
+struct streamChunk
+{
+    off_t off;
+    int bytes, count;
+};
+
+// a set of chunks written to a file
+struct streamFile
+{
+    int fd;
+    struct streamChunk *chunks;
+    int nchunks, cap;
+    off_t end;
+};
+
+struct mmStream
+{
+    const struct mmConfig *cfg;
+    char path[1024];     // template of the temporary files
+    struct streamFile cur;
+    long n;
+    int chunkCodes;      // codes per chunk
+    int bufBytes;        // bytes per chunk buffer
+    uint8_t *bufs[2];    // read buffers
+    uint8_t *out;        // write buffer
+    uint64_t *keys;      // chunkCodes decoded keys
+    uint8_t *digits;     // chunkCodes * seqlen decoded digits
+    uint8_t *fbs;        // chunkCodes feedback ids
+    struct mmStreamStats st;
+};
+
+/* ======================================================= */
+/* SECTION: chunk files                                    */
+/* ------------------------------------------------------- */
+
+/* a new temporary file, removed from the directory at once so it goes away with the process */
+static int streamFileOpen(struct mmStream *s, struct streamFile *f)
+{
+    char path[sizeof(s->path)];
+
+    memset(f, 0, sizeof(*f));
+    memcpy(path, s->path, sizeof(path));
+    f->fd = mkstemp(path);
+    if (f->fd < 0)
+        return -1;
+    unlink(path);
+    return 0;
+}
+
+static void streamFileClose(struct streamFile *f)
+{
+    if (f->fd >= 0)
+        close(f->fd);
+    free(f->chunks);
+    memset(f, 0, sizeof(*f));
+    f->fd = -1;
+}
+
+// encodes keys in increasing order into chunks of a file
+struct streamWriter
+{
+    struct mmStream *s;
+    struct streamFile *f;
+    int bytes, count;
+    uint64_t last;
+    int error;
+};
+
+static void streamFlush(struct streamWriter *w)
+{
+    struct streamFile *f = w->f;
+    const uint8_t *p = w->s->out;
+    int left = w->bytes;
+
+    if (w->count == 0)
+        return;
+    while (left > 0 && !w->error)
+    {
+        ssize_t k = pwrite(f->fd, p, left, f->end + (p - w->s->out));
+        if (k <= 0)
+            w->error = 1;
+        else
+            p += k, left -= k;
+    }
+    if (!w->error && f->nchunks == f->cap)
+    {
+        int cap = f->cap ? 2 * f->cap : 64;
+        struct streamChunk *chunks = (struct streamChunk *)realloc(f->chunks, cap * sizeof(struct streamChunk));
+
+        if (chunks == NULL)
+            w->error = 1;
+        else
+            f->chunks = chunks, f->cap = cap;
+    }
+    // a chunk that was not written, or cannot be listed, is dropped; the pass fails on the error
+    if (!w->error)
+    {
+        f->chunks[f->nchunks].off = f->end;
+        f->chunks[f->nchunks].bytes = w->bytes;
+        f->chunks[f->nchunks].count = w->count;
+        f->nchunks++;
+        f->end += w->bytes;
+        w->s->st.bytesWritten += w->bytes;
+    }
+    w->bytes = w->count = 0;
+    w->last = 0;
+}
+
+static inline void streamPut(struct streamWriter *w, uint64_t key)
+{
+    uint64_t d;
+    uint8_t *p;
+
+    if (w->count == w->s->chunkCodes || w->bytes + STREAM_VARINT > w->s->bufBytes)
+        streamFlush(w);
+    d = key - w->last;
+    p = w->s->out + w->bytes;
+    while (d >= 0x80)
+    {
+        *p++ = (uint8_t)d | 0x80;
+        d >>= 7;
+    }
+    *p++ = (uint8_t)d;
+    w->bytes = p - w->s->out;
+    w->count++;
+    w->last = key;
+}
+
+/* ======================================================= */
+/* SECTION: double-buffered passes                         */
+/* ------------------------------------------------------- */
+
+// loads chunk k into buffer k % 2 while the caller works on chunk k - 1
+struct streamReader
+{
+    struct mmStream *s;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int full[2];
+    int error;
+};
+
+static void *streamReadAhead(void *p)
+{
+    struct streamReader *r = (struct streamReader *)p;
+    const struct streamFile *f = &r->s->cur;
+
+    for (int k = 0; k < f->nchunks; k++)
+    {
+        uint8_t *buf = r->s->bufs[k % 2];
+        int got = 0, err = 0;
+
+        pthread_mutex_lock(&r->lock);
+        while (r->full[k % 2])
+            pthread_cond_wait(&r->cond, &r->lock);
+        pthread_mutex_unlock(&r->lock);
+
+        while (got < f->chunks[k].bytes && !err)
+        {
+            ssize_t n = pread(f->fd, buf + got, f->chunks[k].bytes - got, f->chunks[k].off + got);
+            if (n <= 0)
+                err = 1;
+            else
+                got += n;
+        }
+
+        pthread_mutex_lock(&r->lock);
+        r->error |= err;
+        r->full[k % 2] = 1;
+        pthread_cond_broadcast(&r->cond);
+        pthread_mutex_unlock(&r->lock);
+    }
+    return NULL;
+}
+
+/* decode the @count@ codes at @p@ into the keys and digits of @s@ */
+static void streamDecode(struct mmStream *s, const uint8_t *p, int count)
+{
+    int L = s->cfg->seqlen;
+    uint64_t key = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        uint64_t d = 0;
+        int shift = 0;
+        do
+            d |= (uint64_t)(*p & 0x7f) << shift, shift += 7;
+        while (*p++ & 0x80);
+        key += d;
+        s->keys[i] = key;
+        for (int j = 0; j < L; j++)
+            s->digits[(long)i * L + j] = (key >> (4 * (L - 1 - j))) & 15;
+    }
+}
+
+/* call @fn@ on each chunk of the set, decoded; returns -1 on a read error */
+static int streamPass(struct mmStream *s, void (*fn)(void *ctx, struct mmStream *s, int count), void *ctx)
+{
+    struct streamReader r;
+    uint64_t t0;
+    int k, started;
+
+    memset(&r, 0, sizeof(r));
+    r.s = s;
+    pthread_mutex_init(&r.lock, NULL);
+    pthread_cond_init(&r.cond, NULL);
+    started = pthread_create(&r.thread, NULL, streamReadAhead, &r) == 0;
+    if (!started)
+        r.error = 1;
+
+    for (k = 0; k < s->cur.nchunks && !r.error; k++)
+    {
+        t0 = timeInMicroseconds();
+        pthread_mutex_lock(&r.lock);
+        while (!r.full[k % 2])
+            pthread_cond_wait(&r.cond, &r.lock);
+        pthread_mutex_unlock(&r.lock);
+        s->st.ioWait += timeInMicroseconds() - t0;
+        if (r.error)
+            break;
+
+        streamDecode(s, s->bufs[k % 2], s->cur.chunks[k].count);
+        s->st.bytesRead += s->cur.chunks[k].bytes;
+
+        // the buffer can be refilled while the chunk is processed
+        pthread_mutex_lock(&r.lock);
+        r.full[k % 2] = 0;
+        pthread_cond_broadcast(&r.cond);
+        pthread_mutex_unlock(&r.lock);
+
+        fn(ctx, s, s->cur.chunks[k].count);
+    }
+
+    // let the reader run to its end if the pass stopped early
+    for (; k < s->cur.nchunks && started; k++)
+    {
+        pthread_mutex_lock(&r.lock);
+        while (!r.full[k % 2])
+            pthread_cond_wait(&r.cond, &r.lock);
+        r.full[k % 2] = 0;
+        pthread_cond_broadcast(&r.cond);
+        pthread_mutex_unlock(&r.lock);
+    }
+    if (started)
+        pthread_join(r.thread, NULL);
+    pthread_mutex_destroy(&r.lock);
+    pthread_cond_destroy(&r.cond);
+    s->st.passes++;
+    return r.error ? -1 : 0;
+}
+
+/* ======================================================= */
+/* SECTION: streamed sets                                  */
+/* ------------------------------------------------------- */
+
+struct mmStream *mmStreamCreate(const struct mmConfig *cfg, const char *dir, size_t memCap)
+{
+    struct mmStream *s;
+    int L = cfg->seqlen;
+
+    if (memCap < STREAM_MIN_CAP)
+        memCap = STREAM_MIN_CAP;
+    s = (struct mmStream *)calloc(1, sizeof(struct mmStream));
+    if (s == NULL)
+        return NULL;
+    s->cfg = cfg;
+    snprintf(s->path, sizeof(s->path), "%s/mm-stream-XXXXXX", dir ? dir : "/tmp");
+
+    // half of the cap for the decoded chunk, the other half for the three encoded buffers
+    s->chunkCodes = (int)(memCap / 2 / (sizeof(uint64_t) + L + 1));
+    s->bufBytes = (int)(memCap / 2 / 3);
+    if (s->bufBytes < STREAM_VARINT)
+        s->bufBytes = STREAM_VARINT;
+    s->bufs[0] = (uint8_t *)malloc(s->bufBytes);
+    s->bufs[1] = (uint8_t *)malloc(s->bufBytes);
+    s->out = (uint8_t *)malloc(s->bufBytes);
+    s->keys = (uint64_t *)malloc(s->chunkCodes * sizeof(uint64_t));
+    s->digits = (uint8_t *)malloc((size_t)s->chunkCodes * L);
+    s->fbs = (uint8_t *)malloc(s->chunkCodes);
+    s->st.resident = 3 * (size_t)s->bufBytes + (size_t)s->chunkCodes * (sizeof(uint64_t) + L + 1);
+    s->cur.fd = -1;
+    if (!s->bufs[0] || !s->bufs[1] || !s->out || !s->keys || !s->digits || !s->fbs ||
+        streamFileOpen(s, &s->cur) != 0)
+    {
+        mmStreamDestroy(s);
+        return NULL;
+    }
+    return s;
+}
+
+void mmStreamDestroy(struct mmStream *s)
+{
+    if (s == NULL)
+        return;
+    streamFileClose(&s->cur);
+    free(s->bufs[0]);
+    free(s->bufs[1]);
+    free(s->out);
+    free(s->keys);
+    free(s->digits);
+    free(s->fbs);
+    free(s);
+}
+
+long mmStreamSize(const struct mmStream *s)
+{
+    return s->n;
+}
+
+/* replace the set of @s@ by the file @f@ of @n@ codes */
+static void streamReplace(struct mmStream *s, struct streamFile *f, long n)
+{
+    streamFileClose(&s->cur);
+    s->cur = *f;
+    s->n = n;
+    s->st.chunks = f->nchunks;
+    s->st.bytes = f->end;
+}
+
+/* the keys are counted up in base colors, one nibble per position */
+long mmStreamAll(struct mmStream *s)
+{
+    const struct mmConfig *cfg = s->cfg;
+    struct streamFile f;
+    struct streamWriter w;
+    uint64_t key = 0;
+    long n = 0;
+    int j;
+
+    if (streamFileOpen(s, &f) != 0)
+        return -1;
+    memset(&w, 0, sizeof(w));
+    w.s = s;
+    w.f = &f;
+    do
+    {
+        streamPut(&w, key);
+        n++;
+        for (j = 0; j < cfg->seqlen; j++)
+        {
+            uint64_t nib = (key >> (4 * j)) & 15;
+            if (nib + 1 < (uint64_t)cfg->colors)
+            {
+                key += 1ULL << (4 * j);
+                break;
+            }
+            key &= ~(15ULL << (4 * j));
+        }
+    } while (j < cfg->seqlen && !w.error);
+    streamFlush(&w);
+    if (w.error)
+    {
+        streamFileClose(&f);
+        return -1;
+    }
+    streamReplace(s, &f, n);
+    return n;
+}
+
+struct streamFilterCtx
+{
+    const uint8_t *guess;
+    int fb;
+    struct streamWriter w;
+    long n;
+};
+
+static void streamFilterChunk(void *ctx, struct mmStream *s, int count)
+{
+    struct streamFilterCtx *fc = (struct streamFilterCtx *)ctx;
+
+    mmScoreBatch(s->cfg, fc->guess, s->digits, count, s->fbs);
+    for (int i = 0; i < count; i++)
+        if (s->fbs[i] == fc->fb)
+        {
+            streamPut(&fc->w, s->keys[i]);
+            fc->n++;
+        }
+}
+
+long mmStreamFilter(struct mmStream *s, const uint8_t *guess, int fb)
+{
+    struct streamFile f;
+    struct streamFilterCtx fc;
+
+    if (streamFileOpen(s, &f) != 0)
+        return -1;
+    memset(&fc, 0, sizeof(fc));
+    fc.guess = guess;
+    fc.fb = fb;
+    fc.w.s = s;
+    fc.w.f = &f;
+    if (streamPass(s, streamFilterChunk, &fc) != 0 || (streamFlush(&fc.w), fc.w.error))
+    {
+        streamFileClose(&f);
+        return -1;
+    }
+    streamReplace(s, &f, fc.n);
+    return fc.n;
+}
+
+struct streamCountCtx
+{
+    const uint8_t *guesses;
+    int ng;
+    long *counts; // ng * nfb
+    struct mmStream *s;
+    int count;
+};
+
+static void streamCountGuess(void *ctx, int g, int worker)
+{
+    struct streamCountCtx *cc = (struct streamCountCtx *)ctx;
+    const struct mmConfig *cfg = cc->s->cfg;
+    int counts[MM_MAX_FB];
+
+    (void)worker;
+    mmHistogram(cfg, MM_HIST_SIMD, cc->guesses + (long)g * cfg->seqlen, cc->s->digits, cc->count, counts);
+    for (int f = 0; f < cfg->nfb; f++)
+        cc->counts[(long)g * cfg->nfb + f] += counts[f];
+}
+
+static void streamCountChunk(void *ctx, struct mmStream *s, int count)
+{
+    struct streamCountCtx *cc = (struct streamCountCtx *)ctx;
+
+    (void)s;
+    cc->count = count;
+    for (int g = 0; g < cc->ng; g++)
+        streamCountGuess(cc, g, 0);
+}
+
+int mmStreamCounts(struct mmStream *s, const uint8_t *guess, long *counts)
+{
+    struct streamCountCtx cc;
+
+    memset(counts, 0, s->cfg->nfb * sizeof(long));
+    memset(&cc, 0, sizeof(cc));
+    cc.guesses = guess;
+    cc.ng = 1;
+    cc.counts = counts;
+    cc.s = s;
+    return streamPass(s, streamCountChunk, &cc);
+}
+
+// guesses are spread over the pool, chunk by chunk
+struct streamSelectCtx
+{
+    struct streamCountCtx cc;
+    struct mmPool *pool;
+};
+
+static void streamSelectChunk(void *ctx, struct mmStream *s, int count)
+{
+    struct streamSelectCtx *sc = (struct streamSelectCtx *)ctx;
+
+    (void)s;
+    sc->cc.count = count;
+    mmPoolFor(sc->pool, sc->cc.ng, streamCountGuess, &sc->cc);
+}
+
+int mmStreamSelect(struct mmStream *s, struct mmPool *pool, int mode, const uint8_t *guesses, int ng,
+                   struct mmGuessScore *best)
+{
+    const struct mmConfig *cfg = s->cfg;
+    struct streamSelectCtx sc;
+    struct mmGuessScore score, top;
+    int bestGuess = -1;
+
+    memset(&sc, 0, sizeof(sc));
+    sc.cc.guesses = guesses;
+    sc.cc.ng = ng;
+    sc.cc.counts = (long *)calloc((size_t)ng * cfg->nfb, sizeof(long));
+    sc.cc.s = s;
+    sc.pool = pool;
+    if (sc.cc.counts == NULL || streamPass(s, streamSelectChunk, &sc) != 0)
+    {
+        free(sc.cc.counts);
+        return -1;
+    }
+
+    // same scores as mmScoreGuess
+    for (int g = 0; g < ng; g++)
+    {
+        const long *counts = sc.cc.counts + (long)g * cfg->nfb;
+        double h = 0.0;
+        long worst = 0;
+
+        memset(&score, 0, sizeof(score));
+        for (int f = 0; f < cfg->nfb; f++)
+        {
+            if (counts[f] == 0)
+                continue;
+            score.parts++;
+            if (counts[f] > worst)
+                worst = counts[f];
+            h -= (double)counts[f] / s->n * log2((double)counts[f] / s->n);
+        }
+        score.worst = worst < 0x7fffffff ? (int)worst : 0x7fffffff;
+        score.entropy = h;
+        score.inSet = counts[cfg->winFb] > 0;
+        if (bestGuess < 0 || mmGuessBetter(mode, &score, &top))
+        {
+            top = score;
+            bestGuess = g;
+        }
+    }
+    if (best && bestGuess >= 0)
+        *best = top;
+    free(sc.cc.counts);
+    return bestGuess;
+}
+
+struct streamReadCtx
+{
+    uint8_t *codes;
+    long max, n;
+};
+
+static void streamReadChunk(void *ctx, struct mmStream *s, int count)
+{
+    struct streamReadCtx *rc = (struct streamReadCtx *)ctx;
+    long k = count < rc->max - rc->n ? count : rc->max - rc->n;
+
+    memcpy(rc->codes + rc->n * s->cfg->seqlen, s->digits, k * s->cfg->seqlen);
+    rc->n += k;
+}
+
+long mmStreamRead(struct mmStream *s, uint8_t *codes, long max)
+{
+    struct streamReadCtx rc = {codes, max, 0};
+
+    if (streamPass(s, streamReadChunk, &rc) != 0)
+        return -1;
+    return rc.n;
+}
+
+void mmStreamStats(const struct mmStream *s, struct mmStreamStats *st)
+{
+    *st = s->st;
+}
@@ -0,0 +1,177 @@
+/*
+ * Symmetry reduction for the guess search.
+ *
+ * Permuting the positions and renaming the colours of both codes does not
+ * change their feedback. So a pair (position permutation, colour renaming)
+ * that maps every guess of the history onto itself also maps the set of
+ * consistent codes onto itself, and two guesses related by such a pair are
+ * equally good. The group of these pairs is kept per history: colours that
+ * have not been played yet are free, and may be renamed in any way among
+ * themselves; the colours already played must follow the history.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+#include "mm-solver.h"
+
+/* next permutation of @p@ in lexicographic order; returns 0 after the last one */
+static int nextPermutation(uint8_t *p, int n)
+{
+    int i = n - 2, j;
+    uint8_t t;
+
+    while (i >= 0 && p[i] >= p[i + 1])
+        i--;
+    if (i < 0)
+        return 0;
+    for (j = n - 1; p[j] <= p[i]; j--)
+        ;
+    t = p[i], p[i] = p[j], p[j] = t;
+    for (i++, j = n - 1; i < j; i++, j--)
+        t = p[i], p[i] = p[j], p[j] = t;
+    return 1;
+}
+
+static int symAlloc(struct mmSymmetry *sym, int seqlen, int colors, int cap)
+{
+    sym->seqlen = seqlen;
+    sym->colors = colors;
+    sym->nelem = 0;
+    sym->pos = (uint8_t *)malloc((size_t)cap * seqlen);
+    sym->col = (int8_t *)malloc((size_t)cap * colors);
+    return sym->pos && sym->col ? 0 : -1;
+}
+
+int mmSymInit(const struct mmConfig *cfg, struct mmSymmetry *sym)
+{
+    uint8_t p[MM_MAX_SEQL];
+    int i, cap = 1;
+
+    // all position permutations, up to MM_SYM_MAX_SEQL positions
+    if (cfg->seqlen <= MM_SYM_MAX_SEQL)
+        for (i = 2; i <= cfg->seqlen; i++)
+            cap *= i;
+    if (symAlloc(sym, cfg->seqlen, cfg->colors, cap) != 0)
+        return -1;
+
+    for (i = 0; i < cfg->seqlen; i++)
+        p[i] = i;
+    do
+    {
+        memcpy(sym->pos + (long)sym->nelem * sym->seqlen, p, sym->seqlen);
+        memset(sym->col + (long)sym->nelem * sym->colors, -1, sym->colors);
+        sym->nelem++;
+    } while (sym->nelem < cap && nextPermutation(p, cfg->seqlen));
+
+    sym->used = 0;
+    return 0;
+}
+
+int mmSymRestrict(const struct mmConfig *cfg, const struct mmSymmetry *parent, int guess,
+                  struct mmSymmetry *child)
+{
+    const uint8_t *g = cfg->digits + (long)guess * cfg->seqlen;
+    int8_t map[MM_MAX_COLS];
+    uint32_t used = parent->used;
+    int e, j;
+
+    for (j = 0; j < cfg->seqlen; j++)
+        used |= 1u << g[j];
+    if (symAlloc(child, parent->seqlen, parent->colors, parent->nelem) != 0)
+        return -1;
+    child->used = used;
+
+    // keep the elements that can be extended to map @guess@ onto itself
+    for (e = 0; e < parent->nelem; e++)
+    {
+        const uint8_t *pos = parent->pos + (long)e * parent->seqlen;
+        uint32_t taken = 0;
+        int ok = 1;
+
+        memcpy(map, parent->col + (long)e * parent->colors, parent->colors);
+        for (j = 0; j < parent->colors; j++)
+            if (map[j] >= 0)
+                taken |= 1u << map[j];
+        for (j = 0; j < cfg->seqlen && ok; j++)
+        {
+            int from = g[pos[j]], to = g[j];
+            if (map[from] >= 0)
+                ok = map[from] == to;
+            else if ((parent->used & (1u << to)) || (taken & (1u << to)))
+                ok = 0; // a free colour can only become another free colour, once
+            else
+            {
+                map[from] = to;
+                taken |= 1u << to;
+            }
+        }
+        if (!ok)
+            continue;
+        memcpy(child->pos + (long)child->nelem * child->seqlen, pos, child->seqlen);
+        memcpy(child->col + (long)child->nelem * child->colors, map, child->colors);
+        child->nelem++;
+    }
+    return 0;
+}
+
+void mmSymFree(struct mmSymmetry *sym)
+{
+    free(sym->pos);
+    free(sym->col);
+    sym->pos = NULL;
+    sym->col = NULL;
+    sym->nelem = 0;
+}
+
+int mmSymCanonical(const struct mmConfig *cfg, const struct mmSymmetry *sym, int code)
+{
+    const uint8_t *d = cfg->digits + (long)code * cfg->seqlen;
+    uint8_t freeCols[MM_MAX_COLS];
+    int nfree = 0, best = INT_MAX, c, e, j;
+
+    for (c = 0; c < cfg->colors; c++)
+        if (!(sym->used & (1u << c)))
+            freeCols[nfree++] = c;
+
+    for (e = 0; e < sym->nelem; e++)
+    {
+        const uint8_t *pos = sym->pos + (long)e * sym->seqlen;
+        const int8_t *col = sym->col + (long)e * sym->colors;
+        int8_t relabel[MM_MAX_COLS];
+        int next = 0, img = 0;
+
+        // free colours are renamed to the smallest free ones, in order of appearance
+        memset(relabel, -1, cfg->colors);
+        for (j = 0; j < cfg->seqlen; j++)
+        {
+            int from = d[pos[j]], to = col[from];
+            if (to < 0)
+            {
+                if (relabel[from] < 0)
+                    relabel[from] = freeCols[next++];
+                to = relabel[from];
+            }
+            img = img * cfg->colors + to;
+        }
+        if (img < best)
+            best = img;
+    }
+    return best;
+}
+
+int mmSymClasses(const struct mmConfig *cfg, const struct mmSymmetry *sym, int *reps)
+{
+    int k = 0;
+
+    // without any symmetry left, every code is its own class
+    if (mmSymTrivial(cfg, sym))
+        return mmAllCodes(cfg, reps);
+    for (int c = 0; c < cfg->ncodes; c++)
+        if (mmSymCanonical(cfg, sym, c) == c)
+            reps[k++] = c;
+    return k;
+}
@@ -0,0 +1,140 @@
+/*
+ * No-repetition variant (Bulls & Cows): codes without a repeated colour.
+ *
+ * When one of two codes has no colour twice, the colours they have in
+ * common are simply the colours of both, so they are counted as the
+ * popcount of the AND of two colour masks, with no per-colour counts. The
+ * exact matches are counted on the digits packed 4 bits each: the XOR of two
+ * codes is zero in the nibbles where they agree.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm-solver.h"
+
+// number of sub-histograms, as in mm-histogram.c
+#define UNIQUE_SUBS 4
+// codes scored per block
+#define UNIQUE_BLOCK 256
+// sets smaller than this go straight into one histogram, as in mm-histogram.c
+#define UNIQUE_SMALL 32
+
+/* ======================================================= */
+/* SECTION: code sets                                      */
+/* ------------------------------------------------------- */
+
+long mmUniqueCount(const struct mmConfig *cfg)
+{
+    long n = 1;
+    for (int j = 0; j < cfg->seqlen; j++)
+        n *= cfg->colors - j;
+    return n > 0 ? n : 0;
+}
+
+/* depth-first over the positions, trying the colours not used yet in increasing order */
+static long uniqueFill(const struct mmConfig *cfg, uint8_t *d, int j, uint32_t used, struct mmUnique *codes, long n)
+{
+    if (j == cfg->seqlen)
+    {
+        codes[n] = mmUniquePack(cfg, d);
+        return n + 1;
+    }
+    for (int c = 0; c < cfg->colors; c++)
+        if (!(used & (1u << c)))
+        {
+            d[j] = c;
+            n = uniqueFill(cfg, d, j + 1, used | (1u << c), codes, n);
+        }
+    return n;
+}
+
+long mmUniqueAll(const struct mmConfig *cfg, struct mmUnique *codes)
+{
+    uint8_t d[MM_MAX_SEQL];
+
+    if (mmUniqueCount(cfg) == 0)
+        return 0;
+    return uniqueFill(cfg, d, 0, 0, codes, 0);
+}
+
+int mmUniqueCodes(const struct mmConfig *cfg, int *set)
+{
+    int n = 0;
+
+    for (int c = 0; c < cfg->ncodes; c++)
+        if (mmPopcount16(mmUniquePack(cfg, cfg->digits + (long)c * cfg->seqlen).mask) == cfg->seqlen)
+            set[n++] = c;
+    return n;
+}
+
+/* ======================================================= */
+/* SECTION: scoring kernels                                */
+/* ------------------------------------------------------- */
+
+/* feedback id of @code@ against the guess of digits @gd@ and colour mask @gm@ */
+static inline int uniqueFb(uint64_t gd, uint32_t gm, struct mmUnique code, int L)
+{
+    uint64_t x = gd ^ code.digits;
+
+    x |= x >> 2;
+    x |= x >> 1;
+    x &= 0x1111111111111111ULL;
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    // exact * (L + 1) + (common - exact), with exact = L - (positions that differ)
+    return (L - (int)((x * 0x0101010101010101ULL) >> 56)) * L + mmPopcount16(gm & code.mask);
+}
+
+/* the feedback ids of a block of codes go to a byte buffer first, in a loop that has no
+   stores to the histogram and so can be vectorised; the buffer is then counted. A handful
+   of codes, such as the 6 of the game's 3x3, is counted directly, as clearing and adding
+   up the sub-histograms would cost more than the codes themselves */
+void mmUniqueHistogram(const struct mmConfig *cfg, const struct mmUnique *guess, const struct mmUnique *codes,
+                       long n, int *counts)
+{
+    int sub[UNIQUE_SUBS][MM_MAX_FB];
+    uint8_t fbs[UNIQUE_BLOCK];
+    const uint64_t gd = guess->digits;
+    const uint32_t gm = guess->mask;
+    const int L = cfg->seqlen;
+
+    if (n < UNIQUE_SMALL)
+    {
+        memset(counts, 0, cfg->nfb * sizeof(int));
+        for (long i = 0; i < n; i++)
+            counts[uniqueFb(gd, gm, codes[i], L)]++;
+        return;
+    }
+    for (int l = 0; l < UNIQUE_SUBS; l++)
+        memset(sub[l], 0, cfg->nfb * sizeof(int));
+    for (long i = 0; i < n; i += UNIQUE_BLOCK)
+    {
+        int m = n - i < UNIQUE_BLOCK ? (int)(n - i) : UNIQUE_BLOCK, k;
+
+        for (k = 0; k < m; k++)
+            fbs[k] = uniqueFb(gd, gm, codes[i + k], L);
+        for (k = 0; k + UNIQUE_SUBS <= m; k += UNIQUE_SUBS)
+            for (int l = 0; l < UNIQUE_SUBS; l++)
+                sub[l][fbs[k + l]]++;
+        for (; k < m; k++)
+            sub[0][fbs[k]]++;
+    }
+
+    memset(counts, 0, cfg->nfb * sizeof(int));
+    for (int l = 0; l < UNIQUE_SUBS; l++)
+        for (int f = 0; f < cfg->nfb; f++)
+            counts[f] += sub[l][f];
+}
+
+long mmUniqueFilter(const struct mmConfig *cfg, struct mmUnique *codes, long n, const struct mmUnique *guess, int fb)
+{
+    struct mmUnique g = *guess;
+    long k = 0;
+
+    for (long i = 0; i < n; i++)
+        if (mmUniqueScore(cfg, g, codes[i]) == fb)
+            codes[k++] = codes[i];
+    return k;
+}
@@ -13,6 +13,8 @@ $ ./testm
 #include <string.h>
 #include <unistd.h>
 
+#include "mm-solver.h"
+
 #define LENGTH 3
 #define COLORS 3
 
@@ -107,17 +109,15 @@ int main (int argc, char **argv) {
     fprintf(stderr, "Testing matches function with sequences %d and %d\n", m, n);
   } else {
     int i, j, n = 10, res, res_c, oks = 0, tot = 0; // number of test cases
+    struct mmRng rng;
     fprintf(stderr, "Running tests of matches function with %d pairs of random input sequences ...\n", n);
     if (opt_n != 0)
       n = opt_n;
-    if (opt_s != 0)
-      srand(opt_s);
-    else
-      srand(1701);
+    mmRngSeed(&rng, opt_s != 0 ? opt_s : 1701);
     for (i=0; i<n; i++) {
       for (j=0; j<seqlen; j++) {
-	seq1[j] = (rand() % seqlen + 1);
-	seq2[j] = (rand() % seqlen + 1);
+	seq1[j] = mmRngBelow(&rng, seqmax) + 1;
+	seq2[j] = mmRngBelow(&rng, seqmax) + 1;
       }
       memcpy(cpy1, seq1, seqlen*sizeof(int));
       memcpy(cpy2, seq2, seqlen*sizeof(int));